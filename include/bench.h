@@ -1,8 +1,14 @@
 #pragma once
 #include "sparse_types.h"
 
+//stream copy / triad bandwidth in GB/s (10^9 bytes), counted like STREAM: 16 and 24 bytes per
+//element, no write allocate
+typedef struct { int threads; long long n; double copy_gbs, triad_gbs; } stream_bw_t;
+
 long long checksum_vec(const int *y, int n);
 double checksum_vec_double(const double *y, int n);
+//elementwise: max |y - y_ref| <= tol * max |y_ref|, so row errors that cancel in a sum still fail
+int same_vec_double_tol(const double *y_ref, const double *y, int n, double tol);
 
 void bench_dense(const int *a, int n_rows, int n_cols, const int *x, int *y, int iters);
 void bench_crs(const crs_t *a, const int *x, int *y, int iters);
@@ -10,4 +16,46 @@ void bench_tjds(const tjds_t *a, const int *x, int *y, int iters);
 
 void bench_crs_double(const crs_d_t *a, const double *x, double *y, int iters);
 void bench_tjds_double(const tjds_d_t *a, const double *x, double *y, int iters);
+void bench_crs_double_par(const crs_d_t *a, const crs_part_t *p, const double *x, double *y, int iters);
+void bench_tjds_double_par(const tjds_d_t *a, scatter_plan_t *p, const double *x, double *y, int iters);
+void bench_ccs_double_par(const ccs_d_t *a, scatter_plan_t *p, const double *x, double *y, int iters);
+void bench_sell_double(const sell_d_t *a, const double *x, double *y, int iters);
+void bench_ell_double(const ell_d_t *a, const double *x, double *y, int iters);
+void bench_hyb_double(const hyb_d_t *a, const double *x, double *y, int iters);
+//mflops of every block kernel on a dense n x n matrix, where fill is 1 for all shapes
+void bench_bcsr_profile(int n, double prof[4][4]);
+//times crs_spmv_double on the same x for the speedup column
+void bench_bcsr_double(const crs_d_t *crs, const bcsr_d_t *a, const double *x, double *y, int iters);
+//times crs_spmv_double on the same x, prints index compression and GB/s of both
+void bench_crs_delta_double(const crs_d_t *crs, const crs_delta_d_t *a, const double *x, double *y, int iters);
+//jds with caller workspace, through perm, with a calloc per call (what jds_spmv does) and row parallel
+void bench_jds_double(const jds_d_t *a, const crs_part_t *p, const double *x, double *y, int iters);
+void bench_crs_double_merge(const crs_d_t *a, crs_merge_t *m, const double *x, double *y, int iters);
+
+
+//crs/ccs build time from triplets for 1, 2, 4 .. max_threads threads, checked against the serial builder
+void bench_build_threads(int n_rows, int n_cols, const triplet_d_t *t, int nnz, int max_threads, int reps);
+
+//tjds build: old qsort + depth x columns scan vs counting sort + active prefix
+void bench_build_tjds(const ccs_d_t *c, int reps);
+
+//every simd level this cpu supports for crs and tjds, speedup vs scalar and max |dy| vs scalar
+void bench_simd_double(const crs_d_t *crs, const tjds_d_t *tjds, const double *x, int iters);
+//crs/tjds with float values (x double and x float) against the double kernels:
+//time, speedup and max relative error of y vs crs_spmv_double
+void bench_mixed_double(const crs_d_t *crs, const tjds_d_t *tjds, const double *x, int iters);
+//full is the expanded matrix, timed with crs_spmv_double / crs_spmv_double_par for reference
+void bench_crs_sym_double(const crs_d_t *full, const crs_sym_d_t *a, sym_plan_t *p, const double *x, double *y,
+                          int iters);
+//per k: k separate crs/tjds spmv calls vs one spmm call, time per vector and max|dY|, then ok
+//or bruh against 1e-10 of the largest |Y|
+void bench_spmm_double(const crs_d_t *crs, const tjds_d_t *tjds, const int *ks, int nk, int iters);
+//A*x and A^T*w: crs + ccs-as-transpose (today's two copies) vs crs transpose, fused, and their
+//thread-parallel versions. prints times and max diff of z against the ccs path
+void bench_transpose_double(const crs_d_t *crs, const ccs_d_t *ccs, const double *x, int iters);
 
+//doubles per array for bench_stream: 4x the last level cache, clamped to 4M..32M
+long long stream_default_n(void);
+//c = a and a = b + s * c over n doubles on nthreads (first touch with the same static split),
+//best of reps
+int bench_stream(long long n, int nthreads, int reps, stream_bw_t *out);
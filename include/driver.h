@@ -0,0 +1,25 @@
+#pragma once
+
+//command line benchmark driver, main hands argv over when it gets any arguments
+//
+//  main [options] matrix [matrix ...]
+//    a matrix is a .mtx path or gen:spec for a synthetic one (gen_from_spec in gen.h),
+//    e.g. gen:poisson3d:100 gen:rmat:20:16 gen:uniform:1e6:10
+//    -f crs,tjds,...   formats from the variant registry, "all" (default) for every one
+//    -t 1,2,4          thread counts for the parallel formats (default: get_num_threads())
+//    -w N              warm-up calls before timing (default 10)
+//    -n N              timed trials (default 30)
+//    -T us             minimum length of one trial, short kernels get batched (default 1000)
+//    -o path           write results, .csv gives csv and anything else json
+//    -p                hardware counters per spmv and per nnz (perf_counters.h), timing only
+//                      when perf_event_open isn't allowed
+//    -b                stream copy / triad probe (1 and all threads) and each run's place on
+//                      the bandwidth roofline, using the formats.h traffic model
+//    -S dir            also write every generated matrix to dir/<spec>.mtx
+//    -a                autotune (tune.h) over the -f formats and -t threads, time only the pick
+//    -M MiB            memory budget per tuner candidate
+//    -C path           tuner cache file, a matrix already in it skips tuning
+//    -l                list the formats and exit
+//
+//returns the process exit code
+int bench_driver_main(int argc, char **argv);
@@ -9,6 +9,15 @@ void free_tjds(tjds_t *a);
 void free_crs_d(crs_d_t *a);
 void free_ccs_d(ccs_d_t *a);
 void free_tjds_d(tjds_d_t *a);
+void free_sell_d(sell_d_t *a);
+void free_ell_d(ell_d_t *a);
+void free_hyb_d(hyb_d_t *a);
+void free_bcsr_d(bcsr_d_t *a);
+void free_crs_delta_d(crs_delta_d_t *a);
+void free_crs_f(crs_f_t *a);
+void free_tjds_f(tjds_f_t *a);
+void free_crs_sym_d(crs_sym_d_t *a);
+void free_jds_d(jds_d_t *a);
 
 crs_t  build_crs_from_dense(const int *dense, int n_rows, int n_cols);
 ccs_t  build_ccs_from_dense(const int *dense, int n_rows, int n_cols);
@@ -19,10 +28,90 @@ int build_crs_from_triplets(int n_rows, int n_cols, const triplet_t *t, int nnz,
 int build_ccs_from_triplets(int n_rows, int n_cols, const triplet_t *t, int nnz, ccs_t *out);
 
 int build_crs_from_triplets_double(int n_rows, int n_cols, const triplet_d_t *t, int nnz, crs_d_t *out);
+int build_ccs_from_crs_double(const crs_d_t *c, ccs_d_t *out);
 int build_ccs_from_triplets_double(int n_rows, int n_cols, const triplet_d_t *t, int nnz, ccs_d_t *out);
 
+//per thread histograms + parallel prefix sum + scatter, same arrays as the serial builders
+//nthreads <= 0 uses get_num_threads(), needs nthreads * n_rows (n_cols) ints of scratch
+int build_crs_from_triplets_double_par(int n_rows, int n_cols, const triplet_d_t *t, int nnz, int nthreads, crs_d_t *out);
+int build_ccs_from_triplets_double_par(int n_rows, int n_cols, const triplet_d_t *t, int nnz, int nthreads, ccs_d_t *out);
+
+//sparse to sparse, no dense n_rows*n_cols array anywhere
+jds_t build_jds_from_crs(const crs_t *c);
+int build_jds_from_triplets(int n_rows, int n_cols, const triplet_t *t, int nnz, jds_t *out);
+int build_tjds_from_triplets(int n_rows, int n_cols, const triplet_t *t, int nnz, tjds_t *out);
+
+//counting sort + active prefix loop, O(nnz + n_cols + num_tjd)
 tjds_t   build_tjds_from_ccs(const ccs_t *c);
 tjds_d_t build_tjds_from_ccs_double(const ccs_d_t *c);
+//old qsort version, same output, only here to benchmark against
+tjds_d_t build_tjds_from_ccs_double_ref(const ccs_d_t *c);
+
+//rows sorted by length into jagged diagonals, same steps as build_jds_from_crs
+int build_jds_from_crs_double(const crs_d_t *c, jds_d_t *out);
+
+//C rows per chunk (1..16, match the vector width), sigma = sort window (1 = no sorting)
+int build_sell_from_crs_double(const crs_d_t *c, int C, int sigma, sell_d_t *out);
+//slots (incl padding) the build above would store, without building it. -1 on bad C / no memory
+long long sell_count_slots(const crs_d_t *c, int C, int sigma);
+//stored slots (incl padding) / nnz
+double sell_padding_ratio(const sell_d_t *a);
+
+//longest row, the ELL width
+int crs_max_row_len(const crs_d_t *c);
+//ELL width = longest row. 0 when that pads to more than ELL_MAX_PAD x nnz slots
+#define ELL_MAX_PAD 16
+int build_ell_from_crs_double(const crs_d_t *c, ell_d_t *out);
+//K < 0 picks it with hyb_choose_width
+int build_hyb_from_crs_double(const crs_d_t *c, int K, hyb_d_t *out);
+//largest K such that at least a third of the rows still have >= K entries (ELL is ~3x faster
+//than COO per entry, so a column of ELL slots pays off while a third of it is real data)
+int hyb_choose_width(const crs_d_t *c);
+//stored ELL slots / real ELL entries
+double ell_padding_ratio(const ell_d_t *a);
+
+//r, c in 1..4 (the unrolled kernels), and r <= n_rows, c <= n_cols
+int build_bcsr_from_crs_double(const crs_d_t *a, int r, int c, bcsr_d_t *out);
+//stored block slots / nnz, counted on every step-th block row (step 1 = exact)
+double bcsr_estimate_fill(const crs_d_t *a, int r, int c, int step);
+//picks the r x c with the best prof[r-1][c-1] / fill (prof = dense mflops per shape, see
+//bench_bcsr_profile), or the fewest estimated bytes per nnz when prof is NULL.
+//fills fill[4][4] if given
+void bcsr_choose_block(const crs_d_t *a, int step, double prof[4][4], int *r, int *c, double fill[4][4]);
+//bytes one spmv streams: values, indices, pointers, x and y once (traffic_lo of bcsr_d_traffic)
+long long bcsr_bytes(const bcsr_d_t *a);
+
+//0 only when out of memory, columns need not be sorted
+int build_crs_delta_from_crs_double(const crs_d_t *a, crs_delta_d_t *out);
+//bytes one spmv streams, same accounting as crs_d_bytes
+long long crs_delta_bytes(const crs_delta_d_t *a);
+long long crs_d_bytes(const crs_d_t *a);
+
+//values rounded to float, index arrays copied
+int crs_d_to_f(const crs_d_t *a, crs_f_t *out);
+int tjds_d_to_f(const tjds_d_t *a, tjds_f_t *out);
+
+//keeps the j <= i part of a square crs that is already (skew-)symmetric, the rest is not checked.
+//skew = 1 fails on a nonzero diagonal entry and drops the explicit zeros
+int build_crs_sym_from_crs_double(const crs_d_t *a, int skew, crs_sym_d_t *out);
+//back to full storage, columns stay ascending if they were in a
+int crs_sym_expand_double(const crs_sym_d_t *a, crs_d_t *out);
+
+//traffic model of one spmv (spmv_traffic_t) for each double / float format
+void crs_d_traffic(const crs_d_t *a, spmv_traffic_t *t);
+void crs_f_traffic(const crs_f_t *a, spmv_traffic_t *t);
+void crs_delta_traffic(const crs_delta_d_t *a, spmv_traffic_t *t);
+void crs_sym_traffic(const crs_sym_d_t *a, spmv_traffic_t *t);
+void ccs_d_traffic(const ccs_d_t *a, spmv_traffic_t *t);
+void jds_d_traffic(const jds_d_t *a, spmv_traffic_t *t);
+void tjds_d_traffic(const tjds_d_t *a, spmv_traffic_t *t);
+void tjds_f_traffic(const tjds_f_t *a, spmv_traffic_t *t);
+void sell_d_traffic(const sell_d_t *a, spmv_traffic_t *t);
+void ell_d_traffic(const ell_d_t *a, spmv_traffic_t *t);
+void hyb_d_traffic(const hyb_d_t *a, spmv_traffic_t *t);
+void bcsr_d_traffic(const bcsr_d_t *a, spmv_traffic_t *t);
+long long traffic_lo(const spmv_traffic_t *t);
+long long traffic_hi(const spmv_traffic_t *t);
 
 void print_crs_hw(const crs_t *a);
 void print_ccs_hw(const ccs_t *a);
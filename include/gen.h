@@ -0,0 +1,41 @@
+#pragma once
+#include "sparse_types.h"
+
+//synthetic matrices, same seed always gives the same matrix
+
+//row lengths follow (rank)^-alpha scaled to ~nnz total, rows shuffled, distinct uniform columns
+//sorted per row
+int gen_powerlaw_crs(int n_rows, int n_cols, long long nnz, double alpha, unsigned long long seed, crs_d_t *out);
+
+//per_row distinct columns per row drawn from the band |i - j| <= half_bw (clipped at the edges),
+//sorted, values uniform in [-1, 1)
+int gen_banded_crs(int n, int half_bw, int per_row, unsigned long long seed, crs_d_t *out);
+
+//uniform random permutation of 0..n-1 (fisher-yates)
+void gen_random_perm(int n, unsigned long long seed, int *perm);
+
+//the rest fill rows in parallel from per row random streams, same matrix for any thread count.
+//values uniform in [-1, 1) unless said otherwise
+
+//nnz spread evenly over the rows (lengths differ by at most 1), distinct sorted columns
+int gen_uniform_crs(int n_rows, int n_cols, long long nnz, unsigned long long seed, crs_d_t *out);
+
+//5 point (4 / -1) and 7 point (6 / -1) laplacians on an nx x ny (x nz) grid, x fastest
+int gen_poisson2d_crs(int nx, int ny, crs_d_t *out);
+int gen_poisson3d_crs(int nx, int ny, int nz, crs_d_t *out);
+
+//r-mat graph on 2^scale vertices, edge_factor * 2^scale edges drawn with quadrant probabilities
+//a, b, c, 1 - a - b - c (graph500 uses .57 .19 .19). repeated edges are kept once, so nnz
+//comes out a bit lower. heavy rows sit at low indices, gen_random_perm scrambles them
+int gen_rmat_crs(int scale, int edge_factor, double a, double b, double c, unsigned long long seed,
+                 crs_d_t *out);
+
+//dense b x b blocks on the diagonal, the last one smaller when b doesn't divide n
+int gen_blockdiag_crs(int n, int b, unsigned long long seed, crs_d_t *out);
+
+//"name:arg:arg..", numbers may be written 1e6. seed defaults to 42
+//  banded:n:half_bw:per_row[:seed]     poisson2d:nx[:ny]      poisson3d:nx[:ny:nz]
+//  uniform:n:nnz_per_row[:seed]        powerlaw:n:nnz_per_row:alpha[:seed]
+//  rmat:scale:edge_factor[:seed]       blockdiag:n:b[:seed]
+//0 on an unknown name, bad arguments (sizes past INT_MAX included) or a failed build
+int gen_from_spec(const char *spec, crs_d_t *out);
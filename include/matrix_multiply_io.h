@@ -1,8 +1,32 @@
 #pragma once
 #include "sparse_types.h"
 
+//filled by the mmap loaders, bytes = whole file size, peak_bytes = largest heap footprint the loader held
+typedef struct { long long bytes, time_ns, peak_bytes; int threads; } mm_stats_t;
+
 int mm_read_dense_int(const char *path, int **out_a, int *out_rows, int *out_cols, int *out_nnz);
 
 int mm_read_triplets_int(const char *path, triplet_t **out_t, int *out_rows, int *out_cols, int *out_nnz);
 int mm_read_triplets_double(const char *path, triplet_d_t **out_t, int *out_rows, int *out_cols, int *out_nnz);
 
+//same output as the fscanf readers but mmaps the file and parses newline aligned chunks on all threads
+//stats can be NULL
+int mm_read_triplets_int_mmap(const char *path, triplet_t **out_t, int *out_rows, int *out_cols, int *out_nnz, mm_stats_t *stats);
+int mm_read_triplets_double_mmap(const char *path, triplet_d_t **out_t, int *out_rows, int *out_cols, int *out_nnz, mm_stats_t *stats);
+
+//two pass streaming build straight from the file, never holds a triplet list
+//pass 1 counts entries per row (col) incl. mirrored ones, pass 2 scatters into the final arrays
+//output is identical to mm_read_triplets_double + build_crs/ccs_from_triplets_double
+int mm_build_crs_double_stream(const char *path, crs_d_t *out, mm_stats_t *stats);
+int mm_build_ccs_double_stream(const char *path, ccs_d_t *out, mm_stats_t *stats);
+
+//symmetric / skew-symmetric files only: keeps the stored triangle (folded to j <= i) instead of
+//mirroring it, so half the entries of mm_build_crs_double_stream
+int mm_build_crs_sym_double_stream(const char *path, crs_sym_d_t *out, mm_stats_t *stats);
+
+//general real coordinate file, 1 based, values in %.17g so they read back bit for bit.
+//comment (may be NULL) goes on a % line under the banner
+int mm_write_crs_double(const char *path, const crs_d_t *a, const char *comment);
+//symmetric or skew-symmetric file of the stored triangle, upper = 1 writes it transposed into j > i.
+//0 for a skew matrix with diagonal entries, which the format doesn't allow
+int mm_write_crs_sym_double(const char *path, const crs_sym_d_t *a, int upper, const char *comment);
@@ -0,0 +1,32 @@
+#pragma once
+
+//hardware counters through perf_event_open, user space only. the six events go in two groups,
+//core (cycles, instructions, branch misses) and memory (l1d, llc, dtlb read misses), so each
+//group is scheduled as a whole and the ratios inside it hold up under multiplexing. counts are
+//scaled by time_enabled / time_running like perf stat does.
+//anything that fails to open (no pmu in a vm, paranoid > 2, seccomp in containers) is just
+//missing, so callers fall back to timing only when perf_team_open returns 0
+
+enum { PC_CYCLES, PC_INSTR, PC_BRANCH_MISS, PC_L1D_MISS, PC_LLC_MISS, PC_DTLB_MISS, PC_N };
+
+typedef struct {
+    double v[PC_N];
+    int have[PC_N];
+} perf_counts_t;
+
+//one counter set per thread of an openmp team. perf counts per thread, so every thread of
+//the team opens its own set from inside a parallel region of the same size the kernels use,
+//and the stop sums them
+typedef struct {
+    int nthreads;
+    int (*fd)[PC_N];    //-1 when the event didn't open
+} perf_team_t;
+
+const char *perf_counter_name(int e);
+
+//nthreads is the size to ask for, t->nthreads the team that actually started. returns how many
+//of the PC_N events every thread of it got, 0 means timing only (and nothing to free)
+int perf_team_open(perf_team_t *t, int nthreads);
+void perf_team_start(perf_team_t *t);
+void perf_team_stop(perf_team_t *t, perf_counts_t *out);
+void free_perf_team(perf_team_t *t);
@@ -0,0 +1,18 @@
+#pragma once
+#include "sparse_types.h"
+
+//reverse cuthill-mckee on the pattern of A + A^T (square matrices only), one pseudo-peripheral
+//start per connected component. perm[new] = old
+int rcm_order(const crs_d_t *a, int *perm);
+
+//B = P A P^T, B(i, j) = A(perm[i], perm[j]), columns ascending in every row
+int crs_permute_sym(const crs_d_t *a, const int *perm, crs_d_t *out);
+
+//xp[i] = x[perm[i]] going in, y[perm[i]] = yp[i] coming out
+void permute_vec(const int *perm, int n, const double *x, double *xp);
+void unpermute_vec(const int *perm, int n, const double *yp, double *y);
+
+//max |i - j| over the entries
+int crs_bandwidth(const crs_d_t *a);
+//sum over rows of how far left of the diagonal the row starts
+long long crs_profile(const crs_d_t *a);
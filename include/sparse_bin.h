@@ -0,0 +1,30 @@
+#pragma once
+#include <stddef.h>
+#include "sparse_types.h"
+
+//versioned binary container for the already built double formats
+//every array starts on a 64 byte boundary so the loader can point straight into the mapping
+
+#define SBIN_VERSION 1
+
+#define SBIN_HAS_CRS  1
+#define SBIN_HAS_CCS  2
+#define SBIN_HAS_TJDS 4
+
+//the structs point into a read only shared mapping, never free_*_d them, call sbin_unmap
+typedef struct {
+    void *base;
+    size_t size;
+    int flags;
+    crs_d_t crs;
+    ccs_d_t ccs;
+    tjds_d_t tjds;
+} sbin_map_t;
+
+//any of crs/ccs/tjds can be NULL, src_path (optional) records the .mtx size+mtime so stale files get rejected
+int sbin_write(const char *path, const crs_d_t *crs, const ccs_d_t *ccs, const tjds_d_t *tjds, const char *src_path);
+
+//returns 0 if missing, corrupt, wrong version or older than src_path (when given). corrupt covers
+//section sizes and offsets plus pointer arrays (0..nnz, non-decreasing) and index ranges
+int sbin_map(const char *path, const char *src_path, sbin_map_t *out);
+void sbin_unmap(sbin_map_t *m);
@@ -1,4 +1,5 @@
 #pragma once
+#include <stdint.h>
 //all indices are 0 based
 typedef struct { int n_rows, n_cols, nnz; int *values, *col_idx, *row_ptr; } crs_t;
 typedef struct { int n_rows, n_cols, nnz; int *values, *row_idx, *col_ptr; } ccs_t;
@@ -26,3 +27,114 @@ typedef struct {
     int *row_idx, *perm, *tjd_ptr;
 } tjds_d_t;
 
+//perm maps packed row to original row, same layout as jds_t
+typedef struct {
+    int n_rows, n_cols, nnz, num_jd;
+    double *jdiag;
+    int *col_idx, *perm, *jdiag_ptr;
+} jds_d_t;
+
+//float values, same layout as crs_d_t / tjds_d_t. kernels still accumulate in double
+typedef struct { int n_rows, n_cols, nnz; float *values; int *col_idx, *row_ptr; } crs_f_t;
+
+typedef struct {
+    int n_rows, n_cols, nnz, num_tjd;
+    float *tjd;
+    int *row_idx, *perm, *tjd_ptr;
+} tjds_f_t;
+
+
+//row split of a crs matrix into nparts chunks with ~equal nnz, part p owns rows [row_start[p], row_start[p+1])
+typedef struct { int nparts; int *row_start; } crs_part_t;
+
+//merge path schedule over (rows + nnz), thread t starts at (start_row[t], start_nz[t])
+//carry_row/carry_val hold the partial row each thread hands to the next one
+typedef struct {
+    int nthreads;
+    int *start_row, *start_nz;
+    int *carry_row;
+    double *carry_val;
+} crs_merge_t;
+
+//thread plan for the kernels that scatter into y[row] (tjds, ccs)
+//private: each thread fills its own slice of ybuf (nthreads * n_rows), then a parallel reduction
+//owner:   entries are bucketed by row range, thread t only touches rows [row_start[t], row_start[t+1])
+//         ent_k/ent_col list its entries in k order, so per row sums happen in the serial order
+typedef struct {
+    int nthreads, mode, n_rows;
+    int *work_start;
+    double *ybuf;
+    int *row_start, *ent_ptr, *ent_k, *ent_col;
+} scatter_plan_t;
+
+//SELL-C-sigma: rows sorted longest first inside windows of sigma rows, then cut into chunks of C
+//rows; a chunk is stored column major (entry j of its C rows side by side) and padded to its
+//longest row with value 0 / a valid column. perm maps packed row to original row
+typedef struct {
+    int n_rows, n_cols, nnz, C, sigma, n_chunks;
+    double *values;
+    int *col_idx, *chunk_ptr, *chunk_len, *perm;
+} sell_d_t;
+
+//ELL: every row padded to `width` slots, stored column major (slot j of row i at j * n_rows + i)
+//padding has value 0 and a valid column. nnz counts real entries only
+typedef struct {
+    int n_rows, n_cols, nnz, width;
+    double *values;
+    int *col_idx;
+} ell_d_t;
+
+//HYB: ELL up to width K for the regular part, the rest of the long rows as COO
+typedef struct {
+    int n_rows, n_cols, nnz;
+    ell_d_t ell;
+    int coo_nnz;
+    int *coo_row, *coo_col;
+    double *coo_val;
+} hyb_d_t;
+
+//BCSR: r x c dense blocks, row major inside a block. bcol_idx is the first column of the block,
+//the last block column is shifted left to n_cols - c so x reads never run past the end.
+//the last block row may stick out past n_rows, its extra rows are zero
+typedef struct {
+    int n_rows, n_cols, nnz, r, c, n_brows, nnzb;
+    double *values;
+    int *brow_ptr, *bcol_idx;
+} bcsr_d_t;
+
+//CRS with 16-bit column offsets. entries are cut into fixed segments of CRS_DELTA_SEG (across
+//rows), each with its own base column, so col = base[k / CRS_DELTA_SEG] + delta[k] and every
+//entry decodes on its own. an entry more than UINT16_MAX past its base is an escape: its slot
+//keeps value 0 and offset 0, and the real entry sits in the esc_row / esc_col / esc_val list
+#define CRS_DELTA_SEG 64
+typedef struct {
+    int n_rows, n_cols, nnz, n_seg, n_esc;
+    double *values;
+    uint16_t *delta;
+    int *row_ptr, *base;
+    int *esc_row, *esc_col;
+    double *esc_val;
+} crs_delta_d_t;
+
+//symmetric (skew = 0) or skew-symmetric (skew = 1, a_ji = -a_ij) CRS that keeps only j <= i.
+//nnz counts stored entries, nnz_full the expanded matrix
+typedef struct {
+    int n, nnz, nnz_full, skew;
+    double *values;
+    int *col_idx, *row_ptr;
+} crs_sym_d_t;
+
+//bytes one spmv moves, split by array. lo reads x and touches y once (every reuse hits cache),
+//hi has no reuse at all: each x gather and each y update goes to memory
+typedef struct {
+    long long values, index;
+    long long x_lo, x_hi, y_lo, y_hi;
+} spmv_traffic_t;
+
+//thread t owns rows [row_start[t], row_start[t+1]), its buffer for the columns
+//[buf_lo[t], row_start[t]) starts at ybuf + buf_off[t]
+typedef struct {
+    int nthreads;
+    int *row_start, *buf_lo, *buf_off;
+    double *ybuf;
+} sym_plan_t;
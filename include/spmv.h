@@ -8,5 +8,111 @@ void jds_spmv(const jds_t *a, const int *x, int *y);
 void tjds_spmv(const tjds_t *a, const int *x, int *y);
 
 void crs_spmv_double(const crs_d_t *a, const double *x, double *y);
+void ccs_spmv_double(const ccs_d_t *a, const double *x, double *y);
 void tjds_spmv_double(const tjds_d_t *a, const double *x, double *y);
+void sell_spmv_double(const sell_d_t *a, const double *x, double *y);
+void ell_spmv_double(const ell_d_t *a, const double *x, double *y);
+void hyb_spmv_double(const hyb_d_t *a, const double *x, double *y);
+void bcsr_spmv_double(const bcsr_d_t *a, const double *x, double *y);
+void crs_delta_spmv_double(const crs_delta_d_t *a, const double *x, double *y);
 
+//float values, double accumulation; _xf also takes x as float
+void crs_f_spmv_double(const crs_f_t *a, const double *x, double *y);
+void crs_f_spmv_xf(const crs_f_t *a, const float *x, double *y);
+void tjds_f_spmv_double(const tjds_f_t *a, const double *x, double *y);
+void tjds_f_spmv_xf(const tjds_f_t *a, const float *x, double *y);
+
+//each stored a_ij (j < i) also adds +-a_ij * x[i] into y[j]
+void crs_sym_spmv_double(const crs_sym_d_t *a, const double *x, double *y);
+
+
+//Y = A * X for k vectors at once, X is n_cols x k and Y n_rows x k, both row major.
+//every matrix entry is loaded once for all k columns. k = 2, 4, 8, 16, 32 have kernels with k
+//fixed at compile time, k = 1 is plain spmv and anything else takes the generic loop
+void crs_spmm_double(const crs_d_t *a, const double *X, int k, double *Y);
+void tjds_spmm_double(const tjds_d_t *a, const double *X, int k, double *Y);
+
+//work (n_rows doubles, caller owned) collects packed rows and is scattered through perm at the
+//end; work = NULL accumulates into y[perm[r]] directly. neither allocates
+void jds_spmv_double(const jds_d_t *a, const double *x, double *y, double *work);
+
+//z = A^T * w straight from the crs arrays (z has n_cols entries), no ccs copy needed
+void crs_spmv_transpose_double(const crs_d_t *a, const double *w, double *z);
+//y = A * x and z = A^T * w in one pass over values / col_idx
+void crs_spmv_fused_double(const crs_d_t *a, const double *x, double *y, const double *w, double *z);
+
+//nnz balanced row partition (binary search on row_ptr), build once per matrix and reuse
+//nparts <= 0 uses get_num_threads()
+int crs_partition_nnz(const crs_d_t *a, int nparts, crs_part_t *out);
+void free_crs_part(crs_part_t *p);
+//one thread per part
+void crs_spmv_double_par(const crs_d_t *a, const crs_part_t *p, const double *x, double *y);
+
+//packed jds rows split by nnz (rows are sorted, so this is not the crs split), part p owns
+//packed rows [row_start[p], row_start[p+1]). nparts <= 0 uses get_num_threads()
+int jds_partition_nnz(const jds_d_t *a, int nparts, crs_part_t *out);
+//work is required here, every thread only touches its own slice of it and of y (perm is 1:1)
+void jds_spmv_double_par(const jds_d_t *a, const crs_part_t *p, const double *x, double *y, double *work);
+
+//merge path split of rows + nnz into equal pieces, long rows get cut between threads and
+//fixed up with a carry out pass, nthreads <= 0 uses get_num_threads()
+int crs_merge_plan(const crs_d_t *a, int nthreads, crs_merge_t *out);
+void free_crs_merge(crs_merge_t *m);
+void crs_spmv_double_merge(const crs_d_t *a, crs_merge_t *m, const double *x, double *y);
+
+#define SCATTER_AUTO    0
+#define SCATTER_PRIVATE 1
+#define SCATTER_OWNER   2
+
+//auto picks private buffers when nthreads * n_rows <= nnz (reduction is cheap next to the
+//matrix itself), otherwise row ownership; nthreads <= 0 uses get_num_threads()
+int tjds_par_plan(const tjds_d_t *a, int nthreads, int mode, scatter_plan_t *out);
+int ccs_par_plan(const ccs_d_t *a, int nthreads, int mode, scatter_plan_t *out);
+void free_scatter_plan(scatter_plan_t *p);
+const char *scatter_mode_name(int mode);
+
+//private-buffer plan for the transpose: rows split by nnz, one n_cols buffer per thread.
+//nthreads <= 0 uses get_num_threads()
+int crs_trans_plan(const crs_d_t *a, int nthreads, scatter_plan_t *out);
+void crs_spmv_transpose_double_par(const crs_d_t *a, scatter_plan_t *p, const double *w, double *z);
+//y rows are written by their owner directly, z goes through the buffers like the transpose
+void crs_spmv_fused_double_par(const crs_d_t *a, scatter_plan_t *p, const double *x, double *y,
+                               const double *w, double *z);
+
+void tjds_spmv_double_par(const tjds_d_t *a, scatter_plan_t *p, const double *x, double *y);
+void ccs_spmv_double_par(const ccs_d_t *a, scatter_plan_t *p, const double *x, double *y);
+
+//symmetric half storage: nnz balanced rows per thread, the mirrored updates that land below a
+//thread's first row go to a private buffer covering just [buf_lo, row_start) and are summed by
+//the owning thread after a barrier, so no atomics. nthreads <= 0 uses get_num_threads()
+int crs_sym_plan(const crs_sym_d_t *a, int nthreads, sym_plan_t *out);
+void free_sym_plan(sym_plan_t *p);
+void crs_sym_spmv_double_par(const crs_sym_d_t *a, sym_plan_t *p, const double *x, double *y);
+
+/* hand vectorized double kernels (spmv_simd.c) */
+
+#define SIMD_SCALAR 0
+#define SIMD_SSE2   1
+#define SIMD_AVX2   2
+#define SIMD_AVX512 3
+
+typedef void (*crs_d_kernel_t)(const crs_d_t *a, const double *x, double *y);
+typedef void (*tjds_d_kernel_t)(const tjds_d_t *a, const double *x, double *y);
+
+//best level the cpu (cpuid) and os support, SPMV_SIMD env can force it lower
+int simd_detect(void);
+//level picked on first use, the *_simd kernels below always run that one
+int simd_level(void);
+const char *simd_name(int level);
+
+//kernel for one specific level, NULL if this build has none
+crs_d_kernel_t crs_spmv_double_kernel(int level);
+tjds_d_kernel_t tjds_spmv_double_kernel(int level);
+
+void crs_spmv_double_simd(const crs_d_t *a, const double *x, double *y);
+void tjds_spmv_double_simd(const tjds_d_t *a, const double *x, double *y);
+
+//chunk height that fills one vector register at the dispatched level (8 avx512, 4 avx2, 2 sse2)
+int sell_simd_C(void);
+//vector kernel when a->C matches the dispatched level, scalar otherwise
+void sell_spmv_double_simd(const sell_d_t *a, const double *x, double *y);
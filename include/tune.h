@@ -0,0 +1,38 @@
+#pragma once
+#include "sparse_types.h"
+#include "variant.h"
+
+//picks the fastest registry variant x thread count for one matrix by timing short trials, and
+//remembers the pick in a small text cache keyed by the matrix structure and the candidate set
+typedef struct {
+    const spmv_variant_t **fmt;     //candidates, NULL = the whole registry
+    int n_fmt;
+    const int *threads;             //tried for parallel formats, NULL = get_num_threads() only
+    int n_threads;
+    long long mem_budget;           //bytes one candidate may keep (variant mem estimate), <= 0 no limit
+    long long trial_ns;             //timing per candidate, <= 0 uses 20 ms
+    const char *cache_path;         //NULL = no cache
+    int verbose;                    //print every candidate
+} tune_opts_t;
+
+//the winner, h is built and ready for v->run. it may point into the crs it was tuned on
+typedef struct {
+    const spmv_variant_t *v;
+    void *h;
+    int threads;
+    double ns;                      //per spmv in the trials, or as cached
+    int from_cache;
+    unsigned long long fingerprint;
+} spmv_tuned_t;
+
+void tune_opts_default(tune_opts_t *o);
+
+//64-bit fnv-1a of the shape, row_ptr and col_idx (not the values, they don't change the pick),
+//hashed in fixed chunks so every thread count gives the same number
+unsigned long long crs_fingerprint(const crs_d_t *a);
+
+//cache hit: builds the cached pick if it is still a candidate and fits the budget.
+//otherwise every candidate that fits is built, checked against crs, timed, and all but the
+//fastest released; the pick is then written to the cache. 0 if nothing could be built
+int spmv_autotune(const crs_d_t *a, const tune_opts_t *o, spmv_tuned_t *out);
+void free_spmv_tuned(spmv_tuned_t *t);
@@ -3,6 +3,20 @@
 
 long long now_ns(void);
 
+//thread count used by all parallel builders/kernels, defaults to omp max threads
+int get_num_threads(void);
+void set_num_threads(int n);
+
+//VmHWM / VmRSS of this process in kB from /proc, -1 if not available
+long long peak_rss_kb(void);
+long long cur_rss_kb(void);
+//resets VmHWM down to the current rss (linux >= 4.0), returns 0 if not allowed
+int reset_peak_rss(void);
+//runs fn(arg) on one thread in a forked child and returns how far the child's VmHWM rose above
+//the rss it started with (kB), so earlier frees and the parent's pages don't hide anything.
+//-1 if fork or /proc isn't available or fn returned 0
+long long forked_peak_rss_kb(int (*fn)(void *), void *arg);
+
 void print_int_array(const char *name, const int *a, int n);
 void print_vec(const char *name, const int *v, int n);
 
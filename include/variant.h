@@ -0,0 +1,25 @@
+#pragma once
+#include "sparse_types.h"
+
+//one spmv kernel plus the format it runs on, built from a crs matrix. lets a driver run any
+//format by name on any matrix (reordered ones included). a handle may point into the crs it
+//was built from, so keep that alive until release
+typedef struct {
+    const char *name;
+    int parallel;                                       //build uses nthreads
+    int borrows;                                        //handle reads a's own arrays, so traffic
+                                                        //values + index are not its memory
+    void *(*build)(const crs_d_t *a, int nthreads);     //NULL when the format does not fit
+    void (*run)(void *h, const double *x, double *y);
+    void (*release)(void *h);
+    void (*traffic)(void *h, spmv_traffic_t *t);        //bytes one spmv moves, formats.h model
+    long long (*mem)(const crs_d_t *a, int nthreads);   //bytes build will keep, computed from the
+                                                        //crs without building (crs_delta leaves out
+                                                        //its escapes, so tune checks after build too)
+    double tol;                                         //max elementwise error vs double crs, relative to max |y|
+} spmv_variant_t;
+
+int spmv_variant_count(void);
+const spmv_variant_t *spmv_variant_at(int i);
+//NULL if there is no such name
+const spmv_variant_t *spmv_variant_find(const char *name);
@@ -1,5 +1,9 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
 #include "bench.h"
+#include "formats.h"
 #include "util.h"
 #include "spmv.h"
 
@@ -37,6 +41,228 @@ void bench_tjds_double(const tjds_d_t *a, const double *x, double *y, int iters)
     printf("tjds iters = %d time_ns = %lld check = %.6g\n", iters, (t1 - t0), check);
 }
 
+void bench_crs_double_par(const crs_d_t *a, const crs_part_t *p, const double *x, double *y, int iters) {
+    long long t0 = now_ns();
+    double check = 0.0;
+    for (int k = 0; k < iters; k++) {
+        crs_spmv_double_par(a, p, x, y);
+        check += y[k % a->n_rows];
+    }
+    long long t1 = now_ns();
+    printf("crs_par threads = %d iters = %d time_ns = %lld check = %.6g\n", p->nparts, iters, (t1 - t0), check);
+}
+void bench_crs_double_merge(const crs_d_t *a, crs_merge_t *m, const double *x, double *y, int iters) {
+    long long t0 = now_ns();
+    double check = 0.0;
+    for (int k = 0; k < iters; k++) {
+        crs_spmv_double_merge(a, m, x, y);
+        check += y[k % a->n_rows];
+    }
+    long long t1 = now_ns();
+    printf("crs_merge threads = %d iters = %d time_ns = %lld check = %.6g\n", m->nthreads, iters, (t1 - t0), check);
+}
+void bench_tjds_double_par(const tjds_d_t *a, scatter_plan_t *p, const double *x, double *y, int iters) {
+    long long t0 = now_ns();
+    double check = 0.0;
+    for (int k = 0; k < iters; k++) {
+        tjds_spmv_double_par(a, p, x, y);
+        check += y[k % a->n_rows];
+    }
+    long long t1 = now_ns();
+    printf("tjds_par threads = %d mode = %s iters = %d time_ns = %lld check = %.6g\n",
+           p->nthreads, scatter_mode_name(p->mode), iters, (t1 - t0), check);
+}
+
+void bench_ccs_double_par(const ccs_d_t *a, scatter_plan_t *p, const double *x, double *y, int iters) {
+    long long t0 = now_ns();
+    double check = 0.0;
+    for (int k = 0; k < iters; k++) {
+        ccs_spmv_double_par(a, p, x, y);
+        check += y[k % a->n_rows];
+    }
+    long long t1 = now_ns();
+    printf("ccs_par threads = %d mode = %s iters = %d time_ns = %lld check = %.6g\n",
+           p->nthreads, scatter_mode_name(p->mode), iters, (t1 - t0), check);
+}
+void bench_sell_double(const sell_d_t *a, const double *x, double *y, int iters) {
+    long long t0 = now_ns();
+    double check = 0.0;
+    for (int k = 0; k < iters; k++) {
+        sell_spmv_double_simd(a, x, y);
+        check += y[k % a->n_rows];
+    }
+    long long t1 = now_ns();
+    printf("sell C = %d sigma = %d padding = %.3f iters = %d time_ns = %lld check = %.6g\n",
+           a->C, a->sigma, sell_padding_ratio(a), iters, (t1 - t0), check);
+}
+void bench_ell_double(const ell_d_t *a, const double *x, double *y, int iters) {
+    long long t0 = now_ns();
+    double check = 0.0;
+    for (int k = 0; k < iters; k++) {
+        ell_spmv_double(a, x, y);
+        check += y[k % a->n_rows];
+    }
+    long long t1 = now_ns();
+    printf("ell width = %d padding = %.3f iters = %d time_ns = %lld check = %.6g\n",
+           a->width, ell_padding_ratio(a), iters, (t1 - t0), check);
+}
+
+void bench_hyb_double(const hyb_d_t *a, const double *x, double *y, int iters) {
+    long long t0 = now_ns();
+    double check = 0.0;
+    for (int k = 0; k < iters; k++) {
+        hyb_spmv_double(a, x, y);
+        check += y[k % a->n_rows];
+    }
+    long long t1 = now_ns();
+    printf("hyb K = %d padding = %.3f coo = %d (%.1f%%) iters = %d time_ns = %lld check = %.6g\n",
+           a->ell.width, ell_padding_ratio(&a->ell), a->coo_nnz, 100.0 * a->coo_nnz / (a->nnz ? a->nnz : 1),
+           iters, (t1 - t0), check);
+}
+void bench_bcsr_profile(int n, double prof[4][4]) {
+    crs_d_t d;
+    d.n_rows = n;
+    d.n_cols = n;
+    d.nnz = n * n;
+    d.values = (double *)malloc((size_t)n * n * sizeof(double));
+    d.col_idx = (int *)malloc((size_t)n * n * sizeof(int));
+    d.row_ptr = (int *)malloc((size_t)(n + 1) * sizeof(int));
+    double *x = (double *)malloc((size_t)n * sizeof(double));
+    double *y = (double *)malloc((size_t)n * sizeof(double));
+    for (int i = 0; i < 4; i++)
+        for (int j = 0; j < 4; j++) prof[i][j] = 0.0;
+    if (!d.values || !d.col_idx || !d.row_ptr || !x || !y) {
+        free(d.values); free(d.col_idx); free(d.row_ptr); free(x); free(y);
+        return;
+    }
+
+    for (int i = 0; i <= n; i++) d.row_ptr[i] = i * n;
+    for (int k = 0; k < n * n; k++) {
+        d.values[k] = 1.0 + (k % 7) * 0.125;
+        d.col_idx[k] = k % n;
+    }
+    for (int j = 0; j < n; j++) x[j] = 1.0 / (j + 1);
+
+    for (int r = 1; r <= 4; r++) {
+        for (int c = 1; c <= 4; c++) {
+            bcsr_d_t b;
+            if (!build_bcsr_from_crs_double(&d, r, c, &b)) continue;
+            bcsr_spmv_double(&b, x, y);
+
+            int iters = 20;
+            long long t0 = now_ns();
+            for (int k = 0; k < iters; k++) bcsr_spmv_double(&b, x, y);
+            long long t1 = now_ns();
+            prof[r - 1][c - 1] = 2.0 * d.nnz * iters / ((double)(t1 - t0) / 1e3);
+            free_bcsr_d(&b);
+        }
+    }
+
+    free(d.values); free(d.col_idx); free(d.row_ptr); free(x); free(y);
+}
+
+void bench_bcsr_double(const crs_d_t *crs, const bcsr_d_t *a, const double *x, double *y, int iters) {
+    long long t0 = now_ns();
+    for (int k = 0; k < iters; k++) crs_spmv_double(crs, x, y);
+    long long t1 = now_ns();
+
+    double check = 0.0;
+    for (int k = 0; k < iters; k++) {
+        bcsr_spmv_double(a, x, y);
+        check += y[k % a->n_rows];
+    }
+    long long t2 = now_ns();
+
+    long long crs_bytes = crs_d_bytes(crs);
+    double fill = a->nnz ? (double)a->nnzb * a->r * a->c / a->nnz : 1.0;
+    printf("bcsr %dx%d fill = %.3f bytes = %lld (crs %lld) iters = %d time_ns = %lld speedup = %.2fx check = %.6g\n",
+           a->r, a->c, fill, bcsr_bytes(a), crs_bytes, iters, (t2 - t1),
+           (double)(t1 - t0) / (double)((t2 - t1) ? (t2 - t1) : 1), check);
+}
+void bench_crs_delta_double(const crs_d_t *crs, const crs_delta_d_t *a, const double *x, double *y, int iters) {
+    long long t0 = now_ns();
+    for (int k = 0; k < iters; k++) crs_spmv_double(crs, x, y);
+    long long t1 = now_ns();
+
+    double check = 0.0;
+    for (int k = 0; k < iters; k++) {
+        crs_delta_spmv_double(a, x, y);
+        check += y[k % a->n_rows];
+    }
+    long long t2 = now_ns();
+
+    //index bytes: col_idx vs delta + segment bases + esc row / col
+    long long idx_crs = (long long)crs->nnz * (long long)sizeof(int);
+    long long idx_delta = (long long)a->nnz * (long long)sizeof(uint16_t)
+                        + (long long)(a->n_seg + 2LL * a->n_esc) * (long long)sizeof(int);
+    double gbs_crs = (double)crs_d_bytes(crs) * iters / (double)((t1 - t0) ? (t1 - t0) : 1);
+    double gbs_delta = (double)crs_delta_bytes(a) * iters / (double)((t2 - t1) ? (t2 - t1) : 1);
+    printf("crs_delta esc = %d index ratio = %.3f bytes ratio = %.3f iters = %d time_ns = %lld (crs %lld)\n",
+           a->n_esc, (double)idx_delta / (double)(idx_crs ? idx_crs : 1),
+           (double)crs_delta_bytes(a) / (double)crs_d_bytes(crs), iters, (t2 - t1), (t1 - t0));
+    printf("crs_delta GB/s = %.2f (crs %.2f) speedup = %.2fx check = %.6g\n",
+           gbs_delta, gbs_crs, (double)(t1 - t0) / (double)((t2 - t1) ? (t2 - t1) : 1), check);
+}
+void bench_crs_sym_double(const crs_d_t *full, const crs_sym_d_t *a, sym_plan_t *p, const double *x, double *y,
+                          int iters) {
+    crs_part_t part;
+    if (!crs_partition_nnz(full, p->nthreads, &part)) return;
+
+    long long t0 = now_ns();
+    for (int k = 0; k < iters; k++) crs_spmv_double(full, x, y);
+    long long t1 = now_ns();
+    for (int k = 0; k < iters; k++) crs_spmv_double_par(full, &part, x, y);
+    long long t2 = now_ns();
+    double check = 0.0;
+    for (int k = 0; k < iters; k++) {
+        crs_sym_spmv_double(a, x, y);
+        check += y[k % a->n];
+    }
+    long long t3 = now_ns();
+    for (int k = 0; k < iters; k++) crs_sym_spmv_double_par(a, p, x, y);
+    long long t4 = now_ns();
+    free_crs_part(&part);
+
+    long long bytes_full = crs_d_bytes(full);
+    long long bytes_sym = (long long)a->nnz * (long long)(sizeof(double) + sizeof(int))
+                        + (long long)(a->n + 1) * (long long)sizeof(int)
+                        + 2LL * a->n * (long long)sizeof(double);
+    printf("%s stored nnz = %d of %d bytes ratio = %.3f buffer = %d doubles\n", a->skew ? "skew" : "sym",
+           a->nnz, a->nnz_full, (double)bytes_sym / (double)bytes_full, p->buf_off[p->nthreads]);
+    printf("  serial iters = %d crs time_ns = %lld sym time_ns = %lld (%.2fx) check = %.6g\n",
+           iters, (t1 - t0), (t3 - t2), (double)(t1 - t0) / (double)((t3 - t2) ? (t3 - t2) : 1), check);
+    printf("  threads = %d crs_par time_ns = %lld sym_par time_ns = %lld (%.2fx)\n",
+           p->nthreads, (t2 - t1), (t4 - t3), (double)(t2 - t1) / (double)((t4 - t3) ? (t4 - t3) : 1));
+}
+void bench_jds_double(const jds_d_t *a, const crs_part_t *p, const double *x, double *y, int iters) {
+    double *work = (double *)malloc((size_t)a->n_rows * sizeof(double) + 1);
+    if (!work) return;
+
+    long long t0 = now_ns();
+    double check = 0.0;
+    for (int k = 0; k < iters; k++) {
+        jds_spmv_double(a, x, y, work);
+        check += y[k % a->n_rows];
+    }
+    long long t1 = now_ns();
+    for (int k = 0; k < iters; k++) jds_spmv_double(a, x, y, NULL);
+    long long t2 = now_ns();
+    for (int k = 0; k < iters; k++) {
+        double *tmp = (double *)calloc((size_t)a->n_rows, sizeof(double));
+        if (!tmp) break;
+        jds_spmv_double(a, x, y, tmp);
+        free(tmp);
+    }
+    long long t3 = now_ns();
+    for (int k = 0; k < iters; k++) jds_spmv_double_par(a, p, x, y, work);
+    long long t4 = now_ns();
+
+    printf("jds numJd = %d iters = %d time_ns = %lld check = %.6g\n", a->num_jd, iters, (t1 - t0), check);
+    printf("jds_perm iters = %d time_ns = %lld\n", iters, (t2 - t1));
+    printf("jds_calloc iters = %d time_ns = %lld\n", iters, (t3 - t2));
+    printf("jds_par threads = %d iters = %d time_ns = %lld\n", p->nparts, iters, (t4 - t3));
+    free(work);
+}
 
 void bench_dense(const int *a, int n_rows, int n_cols, const int *x, int *y, int iters) {
     long long t0 = now_ns();
@@ -71,3 +297,444 @@ void bench_tjds(const tjds_t *a, const int *x, int *y, int iters) {
     printf("tjds iters = %d time_ns = %lld check = %lld\n", iters, (t1 - t0), check);
 }
 
+
+static int same_crs_arrays(const crs_d_t *a, const crs_d_t *b) {
+    return a->nnz == b->nnz &&
+           memcmp(a->row_ptr, b->row_ptr, (size_t)(a->n_rows + 1) * sizeof(int)) == 0 &&
+           memcmp(a->col_idx, b->col_idx, (size_t)a->nnz * sizeof(int)) == 0 &&
+           memcmp(a->values, b->values, (size_t)a->nnz * sizeof(double)) == 0;
+}
+
+static int same_ccs_arrays(const ccs_d_t *a, const ccs_d_t *b) {
+    return a->nnz == b->nnz &&
+           memcmp(a->col_ptr, b->col_ptr, (size_t)(a->n_cols + 1) * sizeof(int)) == 0 &&
+           memcmp(a->row_idx, b->row_idx, (size_t)a->nnz * sizeof(int)) == 0 &&
+           memcmp(a->values, b->values, (size_t)a->nnz * sizeof(double)) == 0;
+}
+
+void bench_build_threads(int n_rows, int n_cols, const triplet_d_t *t, int nnz, int max_threads, int reps) {
+    crs_d_t crs_ref;
+    ccs_d_t ccs_ref;
+
+    long long best_crs = -1, best_ccs = -1;
+    for (int r = 0; r < reps; r++) {
+        long long t0 = now_ns();
+        if (!build_crs_from_triplets_double(n_rows, n_cols, t, nnz, &crs_ref)) return;
+        long long t1 = now_ns();
+        if (!build_ccs_from_triplets_double(n_rows, n_cols, t, nnz, &ccs_ref)) { free_crs_d(&crs_ref); return; }
+        long long t2 = now_ns();
+        if (best_crs < 0 || t1 - t0 < best_crs) best_crs = t1 - t0;
+        if (best_ccs < 0 || t2 - t1 < best_ccs) best_ccs = t2 - t1;
+        if (r + 1 < reps) {
+            free_crs_d(&crs_ref);
+            free_ccs_d(&ccs_ref);
+        }
+    }
+    printf("build serial      crs time_ns = %lld ccs time_ns = %lld\n", best_crs, best_ccs);
+
+    for (int nt = 1; ; nt *= 2) {
+        if (nt > max_threads) nt = max_threads;
+
+        int ok = 1;
+        long long bc = -1, bx = -1;
+        for (int r = 0; r < reps; r++) {
+            crs_d_t crs;
+            ccs_d_t ccs;
+            long long t0 = now_ns();
+            int got_crs = build_crs_from_triplets_double_par(n_rows, n_cols, t, nnz, nt, &crs);
+            long long t1 = now_ns();
+            int got_ccs = build_ccs_from_triplets_double_par(n_rows, n_cols, t, nnz, nt, &ccs);
+            long long t2 = now_ns();
+
+            ok = ok && got_crs && got_ccs && same_crs_arrays(&crs, &crs_ref) && same_ccs_arrays(&ccs, &ccs_ref);
+            if (bc < 0 || t1 - t0 < bc) bc = t1 - t0;
+            if (bx < 0 || t2 - t1 < bx) bx = t2 - t1;
+            if (got_crs) free_crs_d(&crs);
+            if (got_ccs) free_ccs_d(&ccs);
+        }
+        printf("build threads = %2d crs time_ns = %lld (%.2fx) ccs time_ns = %lld (%.2fx) %s\n",
+               nt, bc, (double)best_crs / (double)bc, bx, (double)best_ccs / (double)bx,
+               ok ? "ok" : "bruh: differs from serial");
+
+        if (nt >= max_threads) break;
+    }
+
+    free_crs_d(&crs_ref);
+    free_ccs_d(&ccs_ref);
+}
+
+static int same_tjds_arrays(const tjds_d_t *a, const tjds_d_t *b) {
+    return a->nnz == b->nnz && a->num_tjd == b->num_tjd &&
+           memcmp(a->tjd_ptr, b->tjd_ptr, (size_t)(a->num_tjd + 1) * sizeof(int)) == 0 &&
+           memcmp(a->perm, b->perm, (size_t)a->n_cols * sizeof(int)) == 0 &&
+           memcmp(a->row_idx, b->row_idx, (size_t)a->nnz * sizeof(int)) == 0 &&
+           memcmp(a->tjd, b->tjd, (size_t)a->nnz * sizeof(double)) == 0;
+}
+
+void bench_build_tjds(const ccs_d_t *c, int reps) {
+    long long best_ref = -1, best_new = -1;
+    int ok = 1;
+
+    for (int r = 0; r < reps; r++) {
+        long long t0 = now_ns();
+        tjds_d_t ref = build_tjds_from_ccs_double_ref(c);
+        long long t1 = now_ns();
+        tjds_d_t fast = build_tjds_from_ccs_double(c);
+        long long t2 = now_ns();
+
+        ok = ok && ref.tjd && fast.tjd && same_tjds_arrays(&ref, &fast);
+        if (best_ref < 0 || t1 - t0 < best_ref) best_ref = t1 - t0;
+        if (best_new < 0 || t2 - t1 < best_new) best_new = t2 - t1;
+
+        free_tjds_d(&ref);
+        free_tjds_d(&fast);
+    }
+
+    printf("tjds build qsort+scan time_ns = %lld counting+active time_ns = %lld (%.1fx) %s\n",
+           best_ref, best_new, (double)best_ref / (double)best_new,
+           ok ? "ok" : "bruh: arrays differ");
+}
+
+static double max_abs_diff(const double *a, const double *b, int n) {
+    double m = 0.0;
+    for (int i = 0; i < n; i++) {
+        double d = fabs(a[i] - b[i]);
+        if (d > m) m = d;
+    }
+    return m;
+}
+
+int same_vec_double_tol(const double *y_ref, const double *y, int n, double tol) {
+    double scale = 0.0;
+    for (int i = 0; i < n; i++) scale = fmax(scale, fabs(y_ref[i]));
+    //an all zero reference still allows rounding-sized noise
+    return max_abs_diff(y_ref, y, n) <= tol * (scale > 0.0 ? scale : 1.0);
+}
+
+void bench_simd_double(const crs_d_t *crs, const tjds_d_t *tjds, const double *x, int iters) {
+    int n = crs->n_rows;
+    double *y_ref = (double *)malloc((size_t)n * sizeof(double));
+    double *y = (double *)malloc((size_t)n * sizeof(double));
+    if (!y_ref || !y) {
+        free(y_ref); free(y);
+        return;
+    }
+    crs_spmv_double(crs, x, y_ref);
+
+    int top = simd_detect();
+    long long base_crs = 0, base_tjds = 0;
+    printf("simd: detected %s, dispatching %s\n", simd_name(top), simd_name(simd_level()));
+
+    for (int level = SIMD_SCALAR; level <= top; level++) {
+        crs_d_kernel_t kc = crs_spmv_double_kernel(level);
+        tjds_d_kernel_t kt = tjds_spmv_double_kernel(level);
+        if (!kc || !kt) continue;
+
+        long long t0 = now_ns();
+        for (int k = 0; k < iters; k++) kc(crs, x, y);
+        long long t1 = now_ns();
+        double dc = max_abs_diff(y, y_ref, n);
+
+        for (int k = 0; k < iters; k++) kt(tjds, x, y);
+        long long t2 = now_ns();
+        double dt = max_abs_diff(y, y_ref, n);
+
+        if (level == SIMD_SCALAR) {
+            base_crs = t1 - t0;
+            base_tjds = t2 - t1;
+        }
+        printf("crs_%-6s iters = %d time_ns = %lld (%.2fx) max|dy| = %.3g\n",
+               simd_name(level), iters, t1 - t0, (double)base_crs / (double)(t1 - t0), dc);
+        printf("tjds_%-6s iters = %d time_ns = %lld (%.2fx) max|dy| = %.3g\n",
+               simd_name(level), iters, t2 - t1, (double)base_tjds / (double)(t2 - t1), dt);
+    }
+
+    free(y_ref);
+    free(y);
+}
+
+//max |dy_i| / (|A||x|)_i, rows with cancellation would blow up a plain |dy_i| / |y_i|.
+//normwise is max|dy| / max|y|
+static double max_rel_err(const double *y_ref, const double *y, const double *scale, int n, double *normwise) {
+    double m = 0.0, dmax = 0.0, ymax = 0.0;
+    for (int i = 0; i < n; i++) {
+        double d = fabs(y[i] - y_ref[i]);
+        if (scale[i] > 0.0 && d / scale[i] > m) m = d / scale[i];
+        if (d > dmax) dmax = d;
+        if (fabs(y_ref[i]) > ymax) ymax = fabs(y_ref[i]);
+    }
+    *normwise = ymax > 0.0 ? dmax / ymax : 0.0;
+    return m;
+}
+
+static void print_mixed(const char *name, int iters, long long t, long long base, const double *y_ref,
+                        const double *y, const double *scale, int n) {
+    double nw;
+    double rel = max_rel_err(y_ref, y, scale, n, &nw);
+    printf("%-10s iters = %d time_ns = %lld (%.2fx) max rel err = %.3g normwise = %.3g\n",
+           name, iters, t, (double)base / (double)(t ? t : 1), rel, nw);
+}
+
+void bench_mixed_double(const crs_d_t *crs, const tjds_d_t *tjds, const double *x, int iters) {
+    int n = crs->n_rows;
+    double *y_ref = (double *)malloc((size_t)n * sizeof(double));
+    double *y = (double *)malloc((size_t)n * sizeof(double));
+    double *scale = (double *)malloc((size_t)n * sizeof(double));
+    float *xf = (float *)malloc((size_t)crs->n_cols * sizeof(float));
+    crs_f_t cf;
+    tjds_f_t tf;
+    int have_cf = crs_d_to_f(crs, &cf);
+    int have_tf = tjds_d_to_f(tjds, &tf);
+    if (!y_ref || !y || !scale || !xf || !have_cf || !have_tf) {
+        free(y_ref); free(y); free(scale); free(xf);
+        if (have_cf) free_crs_f(&cf);
+        if (have_tf) free_tjds_f(&tf);
+        return;
+    }
+    for (int j = 0; j < crs->n_cols; j++) xf[j] = (float)x[j];
+    crs_spmv_double(crs, x, y_ref);
+    for (int i = 0; i < n; i++) {
+        double sum = 0.0;
+        for (int k = crs->row_ptr[i]; k < crs->row_ptr[i + 1]; k++)
+			sum += fabs(crs->values[k] * x[crs->col_idx[k]]);
+        scale[i] = sum;
+    }
+
+    printf("mixed precision: values %zu -> %zu bytes\n",
+           (size_t)crs->nnz * sizeof(double), (size_t)crs->nnz * sizeof(float));
+
+    long long t0 = now_ns();
+    for (int k = 0; k < iters; k++) crs_spmv_double(crs, x, y);
+    long long t1 = now_ns();
+    long long base_crs = t1 - t0;
+    print_mixed("crs_d", iters, base_crs, base_crs, y_ref, y, scale, n);
+
+    t0 = now_ns();
+    for (int k = 0; k < iters; k++) crs_f_spmv_double(&cf, x, y);
+    t1 = now_ns();
+    print_mixed("crs_f", iters, t1 - t0, base_crs, y_ref, y, scale, n);
+
+    t0 = now_ns();
+    for (int k = 0; k < iters; k++) crs_f_spmv_xf(&cf, xf, y);
+    t1 = now_ns();
+    print_mixed("crs_f_xf", iters, t1 - t0, base_crs, y_ref, y, scale, n);
+
+    t0 = now_ns();
+    for (int k = 0; k < iters; k++) tjds_spmv_double(tjds, x, y);
+    t1 = now_ns();
+    long long base_tjds = t1 - t0;
+    print_mixed("tjds_d", iters, base_tjds, base_tjds, y_ref, y, scale, n);
+
+    t0 = now_ns();
+    for (int k = 0; k < iters; k++) tjds_f_spmv_double(&tf, x, y);
+    t1 = now_ns();
+    print_mixed("tjds_f", iters, t1 - t0, base_tjds, y_ref, y, scale, n);
+
+    t0 = now_ns();
+    for (int k = 0; k < iters; k++) tjds_f_spmv_xf(&tf, xf, y);
+    t1 = now_ns();
+    print_mixed("tjds_f_xf", iters, t1 - t0, base_tjds, y_ref, y, scale, n);
+
+    free_crs_f(&cf);
+    free_tjds_f(&tf);
+    free(y_ref);
+    free(y);
+    free(scale);
+    free(xf);
+}
+
+void bench_spmm_double(const crs_d_t *crs, const tjds_d_t *tjds, const int *ks, int nk, int iters) {
+    int n = crs->n_rows, m = crs->n_cols;
+
+    for (int q = 0; q < nk; q++) {
+        int k = ks[q];
+        //X row major for spmm, the same numbers as k separate vectors for spmv
+        double *X = (double *)malloc((size_t)m * k * sizeof(double));
+        double *Y = (double *)malloc((size_t)n * k * sizeof(double));
+        double *xs = (double *)malloc((size_t)m * k * sizeof(double));
+        double *ys = (double *)malloc((size_t)n * k * sizeof(double));
+        if (!X || !Y || !xs || !ys) {
+            free(X); free(Y); free(xs); free(ys);
+            return;
+        }
+        for (int c = 0; c < m; c++) {
+            for (int j = 0; j < k; j++) {
+                double v = 1.0 / (c + 1) + 0.01 * j;
+                X[(size_t)c * k + j] = v;
+                xs[(size_t)j * m + c] = v;
+            }
+        }
+
+        long long t0 = now_ns();
+        for (int it = 0; it < iters; it++)
+            for (int j = 0; j < k; j++) crs_spmv_double(crs, xs + (size_t)j * m, ys + (size_t)j * n);
+        long long t1 = now_ns();
+        for (int it = 0; it < iters; it++) crs_spmm_double(crs, X, k, Y);
+        long long t2 = now_ns();
+
+        double dc = 0.0, scale = 1.0;
+        for (int i = 0; i < n; i++) {
+            for (int j = 0; j < k; j++) {
+                dc = fmax(dc, fabs(Y[(size_t)i * k + j] - ys[(size_t)j * n + i]));
+                scale = fmax(scale, fabs(ys[(size_t)j * n + i]));
+            }
+        }
+
+        for (int it = 0; it < iters; it++)
+            for (int j = 0; j < k; j++) tjds_spmv_double(tjds, xs + (size_t)j * m, ys + (size_t)j * n);
+        long long t3 = now_ns();
+        for (int it = 0; it < iters; it++) tjds_spmm_double(tjds, X, k, Y);
+        long long t4 = now_ns();
+
+        double dt = 0.0;
+        for (int i = 0; i < n; i++)
+            for (int j = 0; j < k; j++)
+				dt = fmax(dt, fabs(Y[(size_t)i * k + j] - ys[(size_t)j * n + i]));
+
+        double per = (double)iters * k;
+        printf("spmm k = %2d crs  ns/vec spmv = %.0f spmm = %.0f (%.2fx) max|dY| = %.3g\n", k,
+               (t1 - t0) / per, (t2 - t1) / per, (double)(t1 - t0) / (double)((t2 - t1) ? (t2 - t1) : 1), dc);
+        printf("spmm k = %2d tjds ns/vec spmv = %.0f spmm = %.0f (%.2fx) max|dY| = %.3g\n", k,
+               (t3 - t2) / per, (t4 - t3) / per, (double)(t3 - t2) / (double)((t4 - t3) ? (t4 - t3) : 1), dt);
+        //same rounding allowance as the transpose check, relative to the largest output
+        int same = fmax(dc, dt) <= 1e-10 * scale;
+        printf("%s: spmm k = %d %s\n", same ? "ok" : "bruh", k, same ? "matches spmv" : "mismatch");
+
+        free(X); free(Y); free(xs); free(ys);
+    }
+}
+
+void bench_transpose_double(const crs_d_t *crs, const ccs_d_t *ccs, const double *x, int iters) {
+    int n = crs->n_rows, m = crs->n_cols;
+    double *w = (double *)malloc((size_t)n * sizeof(double));
+    double *y = (double *)malloc((size_t)n * sizeof(double));
+    double *y_ref = (double *)malloc((size_t)n * sizeof(double));
+    double *z = (double *)malloc((size_t)m * sizeof(double));
+    double *z_ref = (double *)malloc((size_t)m * sizeof(double));
+    scatter_plan_t p;
+    int have_plan = crs_trans_plan(crs, get_num_threads(), &p);
+    if (!w || !y || !y_ref || !z || !z_ref || !have_plan) {
+        free(w); free(y); free(y_ref); free(z); free(z_ref);
+        if (have_plan) free_scatter_plan(&p);
+        return;
+    }
+    for (int i = 0; i < n; i++) w[i] = 1.0 - 1.0 / (i + 2);
+
+    //the ccs arrays of A are the crs arrays of A^T
+    crs_d_t at = { ccs->n_cols, ccs->n_rows, ccs->nnz, ccs->values, ccs->row_idx, ccs->col_ptr };
+
+    long long t0 = now_ns();
+    for (int k = 0; k < iters; k++) {
+        crs_spmv_double(crs, x, y_ref);
+        crs_spmv_double(&at, w, z_ref);
+    }
+    long long t1 = now_ns();
+    for (int k = 0; k < iters; k++) crs_spmv_transpose_double(crs, w, z);
+    long long t2 = now_ns();
+    double dt = max_abs_diff(z, z_ref, m);
+    for (int k = 0; k < iters; k++) crs_spmv_transpose_double_par(crs, &p, w, z);
+    long long t3 = now_ns();
+    double dtp = max_abs_diff(z, z_ref, m);
+    for (int k = 0; k < iters; k++) crs_spmv_fused_double(crs, x, y, w, z);
+    long long t4 = now_ns();
+    double df = fmax(max_abs_diff(z, z_ref, m), max_abs_diff(y, y_ref, n));
+    for (int k = 0; k < iters; k++) crs_spmv_fused_double_par(crs, &p, x, y, w, z);
+    long long t5 = now_ns();
+    double dfp = fmax(max_abs_diff(z, z_ref, m), max_abs_diff(y, y_ref, n));
+
+    printf("transpose: ccs copy = %zu bytes, private buffers = %zu bytes (threads = %d)\n",
+           (size_t)ccs->nnz * (sizeof(double) + sizeof(int)) + (size_t)(m + 1) * sizeof(int),
+           (size_t)p.nthreads * (size_t)m * sizeof(double), p.nthreads);
+    printf("crs + ccs      iters = %d time_ns = %lld\n", iters, (t1 - t0));
+    printf("crs_t          iters = %d time_ns = %lld max|dz| = %.3g\n", iters, (t2 - t1), dt);
+    printf("crs_t_par      iters = %d time_ns = %lld max|dz| = %.3g\n", iters, (t3 - t2), dtp);
+    printf("fused          iters = %d time_ns = %lld (%.2fx vs crs + ccs) max diff = %.3g\n", iters, (t4 - t3),
+           (double)(t1 - t0) / (double)((t4 - t3) ? (t4 - t3) : 1), df);
+    printf("fused_par      iters = %d time_ns = %lld (%.2fx vs crs + ccs) max diff = %.3g\n", iters, (t5 - t4),
+           (double)(t1 - t0) / (double)((t5 - t4) ? (t5 - t4) : 1), dfp);
+    //summation order differs between the kernels, so allow rounding relative to the largest output
+    double scale = 1.0;
+    for (int j = 0; j < m; j++) scale = fmax(scale, fabs(z_ref[j]));
+    for (int i = 0; i < n; i++) scale = fmax(scale, fabs(y_ref[i]));
+    double worst = fmax(fmax(dt, dtp), fmax(df, dfp));
+    printf("%s\n", worst <= 1e-10 * scale ? "ok: transpose/fused match" : "bruh: transpose/fused mismatch");
+
+    free_scatter_plan(&p);
+    free(w); free(y); free(y_ref); free(z); free(z_ref);
+}
+
+long long stream_default_n(void) {
+    long long llc = 0;
+    FILE *f = fopen("/sys/devices/system/cpu/cpu0/cache/index3/size", "r");
+    if (!f) f = fopen("/sys/devices/system/cpu/cpu0/cache/index2/size", "r");
+    if (f) {
+        char unit = 0;
+        if (fscanf(f, "%lld%c", &llc, &unit) >= 1) {
+            if (unit == 'K') llc *= 1024;
+            else if (unit == 'M') llc *= 1024 * 1024;
+        }
+        fclose(f);
+    }
+
+    long long n = 4 * llc / (long long)sizeof(double);
+    if (n < (4LL << 20)) n = 4LL << 20;
+    if (n > (32LL << 20)) n = 32LL << 20;
+    return n;
+}
+
+static void stream_copy(double *restrict c, const double *restrict a, long long n, int nt) {
+    #pragma omp parallel for simd schedule(static) num_threads(nt)
+    for (long long i = 0; i < n; i++)
+		c[i] = a[i];
+}
+
+static void stream_triad(double *restrict a, const double *restrict b, const double *restrict c, double s,
+                         long long n, int nt) {
+    #pragma omp parallel for simd schedule(static) num_threads(nt)
+    for (long long i = 0; i < n; i++)
+		a[i] = b[i] + s * c[i];
+}
+
+int bench_stream(long long n, int nthreads, int reps, stream_bw_t *out) {
+    if (n <= 0 || nthreads < 1 || reps < 1) return 0;
+    double *a = (double *)malloc((size_t)n * sizeof(double));
+    double *b = (double *)malloc((size_t)n * sizeof(double));
+    double *c = (double *)malloc((size_t)n * sizeof(double));
+    if (!a || !b || !c) {
+        free(a); free(b); free(c);
+        return 0;
+    }
+
+    //first touch on the threads that will stream the pages
+    #pragma omp parallel for schedule(static) num_threads(nthreads)
+    for (long long i = 0; i < n; i++) {
+        a[i] = 1.0;
+        b[i] = 2.0;
+        c[i] = 0.0;
+    }
+
+    long long best_copy = 0, best_triad = 0;
+    for (int r = 0; r < reps; r++) {
+        long long t0 = now_ns();
+        stream_copy(c, a, n, nthreads);
+        long long t1 = now_ns();
+        stream_triad(a, b, c, 3.0, n, nthreads);
+        long long t2 = now_ns();
+        if (r == 0 || t1 - t0 < best_copy) best_copy = t1 - t0;
+        if (r == 0 || t2 - t1 < best_triad) best_triad = t2 - t1;
+    }
+
+    //a[i] = 2 + 3 * a_prev[i] every rep, starting from 1
+    double expect = 1.0;
+    for (int r = 0; r < reps; r++)
+		expect = 2.0 + 3.0 * expect;
+    int ok = a[0] == expect && a[n - 1] == expect;
+
+    out->threads = nthreads;
+    out->n = n;
+    out->copy_gbs = 16.0 * (double)n / (double)(best_copy ? best_copy : 1);
+    out->triad_gbs = 24.0 * (double)n / (double)(best_triad ? best_triad : 1);
+
+    free(a); free(b); free(c);
+    return ok;
+}
@@ -0,0 +1,565 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "driver.h"
+#include "matrix_multiply_io.h"
+#include "formats.h"
+#include "spmv.h"
+#include "bench.h"
+#include "util.h"
+#include "variant.h"
+#include "perf_counters.h"
+#include "gen.h"
+#include "tune.h"
+
+typedef struct {
+    const char *matrix;
+    int n_rows, n_cols, nnz;
+    const char *format;
+    int threads;
+    int warmup, trials, calls;      //calls = spmv per trial
+    double min_ns, med_ns, p95_ns;  //per spmv
+    double gflops, gbs;             //at the median
+    long long bytes, bytes_hi;      //traffic model: x / y once, no x / y reuse
+    int ok;
+    int have_roof;
+    double ai, peak_gbs, roof_gflops;   //flops per lo byte, triad GB/s, ai * peak
+    int have_ctr;
+    perf_counts_t ctr;              //per spmv, summed over the team
+} drv_result_t;
+
+typedef struct {
+    const spmv_variant_t **fmt;
+    int n_fmt;
+    int *threads;
+    int n_threads;
+    int warmup, trials;
+    long long min_trial_ns;
+    const char *out_path;
+    int counters;                   //-p, 0 once the first open failed
+    int roofline;                   //-b
+    const char *save_dir;           //-S, generated matrices are written here
+    int autotune;                   //-a, time only the tuner's pick
+    long long mem_budget;           //-M, bytes
+    const char *cache_path;         //-C
+    stream_bw_t bw_one, bw_all;
+} drv_opts_t;
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-f fmt,..|all] [-t 1,2,..] [-w warmup] [-n trials] [-T trial_us] "
+                    "[-o out.json|out.csv] [-p] [-b] [-S dir] [-a] [-M MiB] [-C cache] [-l] matrix.mtx|gen:spec ...\n", prog);
+}
+
+static void list_formats(void) {
+    for (int i = 0; i < spmv_variant_count(); i++) {
+        const spmv_variant_t *v = spmv_variant_at(i);
+        printf("%-10s %s\n", v->name, v->parallel ? "parallel" : "serial");
+    }
+}
+
+//"1,2,4" -> positive ints, 0 on anything else
+static int parse_int_list(const char *s, int **out, int *n) {
+    int cap = 1;
+    for (const char *p = s; *p; p++)
+		if (*p == ',') cap++;
+    int *v = (int *)malloc((size_t)cap * sizeof(int));
+    if (!v) return 0;
+
+    int k = 0;
+    const char *p = s;
+    while (*p) {
+        char *end;
+        long t = strtol(p, &end, 10);
+        if (end == p || t <= 0 || t > 4096 || (*end != ',' && *end != '\0')) { free(v); return 0; }
+        v[k++] = (int)t;
+        p = (*end == ',') ? end + 1 : end;
+    }
+    if (k == 0) { free(v); return 0; }
+    *out = v;
+    *n = k;
+    return 1;
+}
+
+static int parse_formats(const char *s, const spmv_variant_t ***out, int *n) {
+    int total = spmv_variant_count();
+    const spmv_variant_t **v = (const spmv_variant_t **)malloc((size_t)total * sizeof(*v));
+    if (!v) return 0;
+
+    int k = 0;
+    if (strcmp(s, "all") == 0) {
+        for (int i = 0; i < total; i++)
+			v[k++] = spmv_variant_at(i);
+    } else {
+        char *buf = strdup(s);
+        if (!buf) { free(v); return 0; }
+        for (char *save = NULL, *tok = strtok_r(buf, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+            const spmv_variant_t *f = spmv_variant_find(tok);
+            if (!f) {
+                fprintf(stderr, "unknown format '%s' (-l lists them)\n", tok);
+                free(buf); free(v);
+                return 0;
+            }
+            int dup = 0;
+            for (int i = 0; i < k; i++)
+				if (v[i] == f) dup = 1;
+            if (!dup && k < total) v[k++] = f;
+        }
+        free(buf);
+    }
+    if (k == 0) { free(v); return 0; }
+    *out = v;
+    *n = k;
+    return 1;
+}
+
+static int cmp_double_asc(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+//nearest rank on the sorted trials
+static double percentile(const double *s, int n, double q) {
+    int r = (int)(q * n + 0.999999);
+    if (r < 1) r = 1;
+    if (r > n) r = n;
+    return s[r - 1];
+}
+
+//warm-up, then picks how many calls one trial needs to last min_trial_ns so the clock
+//resolution doesn't matter, then times each trial. fills ns[] with per call times
+static int time_trials(const spmv_variant_t *v, void *h, const double *x, double *y, int warmup,
+                       int trials, long long min_trial_ns, double *ns) {
+    long long t0 = now_ns();
+    for (int k = 0; k < warmup; k++) v->run(h, x, y);
+    long long warm = now_ns() - t0;
+
+    double per = warmup > 0 ? (double)warm / warmup : 0.0;
+    if (per <= 0.0) {
+        t0 = now_ns();
+        v->run(h, x, y);
+        per = (double)(now_ns() - t0);
+    }
+    int calls = 1;
+    if (per > 0.0 && per < (double)min_trial_ns) {
+        double c = (double)min_trial_ns / per;
+        calls = c > 1e6 ? 1000000 : (int)c + 1;
+    }
+
+    for (int t = 0; t < trials; t++) {
+        t0 = now_ns();
+        for (int k = 0; k < calls; k++) v->run(h, x, y);
+        ns[t] = (double)(now_ns() - t0) / calls;
+    }
+    return calls;
+}
+
+//one more batch of calls with the counters on, opened on a team as wide as the kernel's so
+//the worker threads are the ones the kernel will run on. 0 if nothing could be opened
+static int count_calls(const spmv_variant_t *v, void *h, const double *x, double *y, int calls,
+                       int nthreads, perf_counts_t *out) {
+    perf_team_t team;
+    if (!perf_team_open(&team, nthreads)) return 0;
+
+    perf_team_start(&team);
+    for (int k = 0; k < calls; k++) v->run(h, x, y);
+    perf_team_stop(&team, out);
+    free_perf_team(&team);
+
+    for (int e = 0; e < PC_N; e++)
+		out->v[e] /= calls;
+    return 1;
+}
+
+static int push_result(drv_result_t **res, int *n, int *cap, const drv_result_t *r) {
+    if (*n == *cap) {
+        int nc = *cap ? *cap * 2 : 32;
+        drv_result_t *p = (drv_result_t *)realloc(*res, (size_t)nc * sizeof(drv_result_t));
+        if (!p) return 0;
+        *res = p;
+        *cap = nc;
+    }
+    (*res)[(*n)++] = *r;
+    return 1;
+}
+
+static void print_header(void) {
+    printf("%-10s %4s %6s %12s %12s %12s %9s %8s %s\n", "format", "thr", "calls", "min ns",
+           "median ns", "p95 ns", "GFLOP/s", "GB/s", "check");
+}
+
+static void print_result(const drv_result_t *r) {
+    printf("%-10s %4d %6d %12.0f %12.0f %12.0f %9.3f %8.2f %s\n", r->format, r->threads, r->calls,
+           r->min_ns, r->med_ns, r->p95_ns, r->gflops, r->gbs, r->ok ? "ok" : "bruh: mismatch");
+    if (!r->have_ctr) return;
+
+    for (int per_nnz = 0; per_nnz <= 1; per_nnz++) {
+        printf("    %-9s", per_nnz ? "per nnz" : "per spmv");
+        for (int e = 0; e < PC_N; e++) {
+            if (!r->ctr.have[e]) printf(" %s -", perf_counter_name(e));
+            else if (per_nnz) printf(" %s %.3f", perf_counter_name(e), r->ctr.v[e] / (r->nnz ? r->nnz : 1));
+            else printf(" %s %.0f", perf_counter_name(e), r->ctr.v[e]);
+        }
+        if (!per_nnz && r->ctr.have[PC_CYCLES] && r->ctr.have[PC_INSTR] && r->ctr.v[PC_CYCLES] > 0)
+            printf(" ipc %.2f", r->ctr.v[PC_INSTR] / r->ctr.v[PC_CYCLES]);
+        printf("\n");
+    }
+}
+
+static void print_roof(const drv_result_t *r) {
+    if (!r->have_roof) return;
+    double frac_lo = r->gbs / r->peak_gbs;
+    double frac_hi = (double)r->bytes_hi / r->med_ns / r->peak_gbs;
+    printf("    roofline  bytes %lld..%lld ai %.3f flop/B roof %.3f GFLOP/s at %.1f GB/s, achieved %.0f%%..%.0f%% of peak%s\n",
+           r->bytes, r->bytes_hi, r->ai, r->roof_gflops, r->peak_gbs, 100.0 * frac_lo, 100.0 * frac_hi,
+           frac_lo > 1.0 ? " (above the memory roof, working set is cache resident)" : "");
+}
+
+//"gen:spec" goes to gen_from_spec (and to save_dir as spec.mtx with ':' -> '_'), anything
+//else is read as a .mtx file
+static int load_matrix(const char *path, const drv_opts_t *o, crs_d_t *a) {
+    if (strncmp(path, "gen:", 4) != 0) {
+        if (mm_build_crs_double_stream(path, a, NULL)) return 1;
+        fprintf(stderr, "couldn't load %s\n", path);
+        return 0;
+    }
+
+    const char *spec = path + 4;
+    long long t0 = now_ns();
+    if (!gen_from_spec(spec, a)) {
+        fprintf(stderr, "bad generator spec '%s' (see gen.h)\n", spec);
+        return 0;
+    }
+    printf("generated %s in %.1f ms\n", spec, (double)(now_ns() - t0) / 1e6);
+
+    if (o->save_dir) {
+        size_t len = strlen(o->save_dir) + strlen(spec) + 8;
+        char *file = (char *)malloc(len);
+        if (!file) return 1;
+        snprintf(file, len, "%s/%s.mtx", o->save_dir, spec);
+        for (char *c = file + strlen(o->save_dir) + 1; *c; c++)
+			if (*c == ':') *c = '_';
+        if (mm_write_crs_double(file, a, path)) printf("wrote %s\n", file);
+        else fprintf(stderr, "couldn't write %s\n", file);
+        free(file);
+    }
+    return 1;
+}
+
+//times one built variant and fills r, h stays owned by the caller
+static int measure(const char *path, const crs_d_t *a, drv_opts_t *o, const spmv_variant_t *v, void *h,
+                   int threads, const double *x, double *y, const double *y_ref, double *ns, drv_result_t *r) {
+    memset(y, 0, (size_t)a->n_rows * sizeof(double));
+    r->matrix = path;
+    r->n_rows = a->n_rows;
+    r->n_cols = a->n_cols;
+    r->nnz = a->nnz;
+    r->format = v->name;
+    r->threads = threads;
+    r->warmup = o->warmup;
+    r->trials = o->trials;
+    r->calls = time_trials(v, h, x, y, o->warmup, o->trials, o->min_trial_ns, ns);
+    r->ok = same_vec_double_tol(y_ref, y, a->n_rows, v->tol);
+    r->have_ctr = 0;
+    if (o->counters) {
+        r->have_ctr = count_calls(v, h, x, y, r->calls, v->parallel ? threads : 1, &r->ctr);
+        if (!r->have_ctr) {
+            printf("hardware counters unavailable (perf_event_open failed), timing only\n");
+            o->counters = 0;
+        }
+    }
+    spmv_traffic_t tr;
+    v->traffic(h, &tr);
+    r->bytes = traffic_lo(&tr);
+    r->bytes_hi = traffic_hi(&tr);
+
+    qsort(ns, (size_t)o->trials, sizeof(double), cmp_double_asc);
+    r->min_ns = ns[0];
+    r->med_ns = percentile(ns, o->trials, 0.5);
+    r->p95_ns = percentile(ns, o->trials, 0.95);
+    r->gflops = r->med_ns > 0 ? 2.0 * a->nnz / r->med_ns : 0.0;
+    r->gbs = r->med_ns > 0 ? (double)r->bytes / r->med_ns : 0.0;
+
+    //a run on fewer threads than the all-thread probe is held to the all-thread peak
+    r->have_roof = o->roofline && r->bytes > 0 && r->med_ns > 0;
+    if (r->have_roof) {
+        r->peak_gbs = (r->threads == 1 ? o->bw_one : o->bw_all).triad_gbs;
+        r->ai = 2.0 * a->nnz / (double)r->bytes;
+        r->roof_gflops = r->ai * r->peak_gbs;
+    }
+    print_result(r);
+    print_roof(r);
+    return 1;
+}
+
+//-a: the tuner picks among the -f formats and -t thread counts, only its pick is timed
+static int run_tuned(const char *path, const crs_d_t *a, drv_opts_t *o, const double *x, double *y,
+                     const double *y_ref, double *ns, drv_result_t *r) {
+    tune_opts_t to;
+    tune_opts_default(&to);
+    to.fmt = o->fmt;
+    to.n_fmt = o->n_fmt;
+    to.threads = o->threads;
+    to.n_threads = o->n_threads;
+    to.mem_budget = o->mem_budget;
+    to.cache_path = o->cache_path;
+    to.verbose = 1;
+
+    spmv_tuned_t t;
+    long long t0 = now_ns();
+    if (!spmv_autotune(a, &to, &t)) {
+        printf("tune: no candidate could be built\n");
+        return 0;
+    }
+    printf("tune: %s in %.1f ms\n", t.from_cache ? "cached" : "tuned", (double)(now_ns() - t0) / 1e6);
+
+    print_header();
+    set_num_threads(t.threads);
+    measure(path, a, o, t.v, t.h, t.threads, x, y, y_ref, ns, r);
+    free_spmv_tuned(&t);
+    return 1;
+}
+
+//every requested format x thread count on one matrix, appended to res
+static int run_matrix(const char *path, drv_opts_t *o, drv_result_t **res, int *n_res, int *cap) {
+    crs_d_t a;
+    if (!load_matrix(path, o, &a)) return 0;
+
+    double *x = (double *)malloc((size_t)a.n_cols * sizeof(double) + 1);
+    double *y_ref = (double *)malloc((size_t)a.n_rows * sizeof(double) + 1);
+    double *y = (double *)malloc((size_t)a.n_rows * sizeof(double) + 1);
+    double *ns = (double *)malloc((size_t)o->trials * sizeof(double));
+    if (!x || !y_ref || !y || !ns) {
+        free(x); free(y_ref); free(y); free(ns);
+        free_crs_d(&a);
+        return 0;
+    }
+    for (int i = 0; i < a.n_cols; i++)
+		x[i] = 1.0 / (i + 1);
+    crs_spmv_double(&a, x, y_ref);
+
+    printf("=== %s: nRows = %d nCols = %d nnz = %d ===\n", path, a.n_rows, a.n_cols, a.nnz);
+
+    int saved_threads = get_num_threads();
+    int loaded = 1;
+    drv_result_t r;
+    if (o->autotune) {
+        if (run_tuned(path, &a, o, x, y, y_ref, ns, &r)) push_result(res, n_res, cap, &r);
+        else loaded = 0;
+    } else {
+        print_header();
+        int one = 1;
+        for (int q = 0; q < o->n_fmt; q++) {
+            const spmv_variant_t *v = o->fmt[q];
+            const int *tl = v->parallel ? o->threads : &one;
+            int nt = v->parallel ? o->n_threads : 1;
+
+            for (int ti = 0; ti < nt; ti++) {
+                set_num_threads(tl[ti]);
+                void *h = v->build(&a, tl[ti]);
+                if (!h) {
+                    printf("%-10s %4d skipped (build failed)\n", v->name, tl[ti]);
+                    continue;
+                }
+                measure(path, &a, o, v, h, tl[ti], x, y, y_ref, ns, &r);
+                v->release(h);
+                if (!push_result(res, n_res, cap, &r)) break;
+            }
+        }
+    }
+    set_num_threads(saved_threads);
+    printf("\n");
+
+    free(x); free(y_ref); free(y); free(ns);
+    free_crs_d(&a);
+    return loaded;
+}
+
+static void json_str(FILE *f, const char *s) {
+    fputc('"', f);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') fprintf(f, "\\%c", *s);
+        else if ((unsigned char)*s < 0x20) fprintf(f, "\\u%04x", (unsigned char)*s);
+        else fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+static int write_json(const char *path, const drv_opts_t *o, const drv_result_t *r, int n) {
+    FILE *f = fopen(path, "w");
+    if (!f) return 0;
+    fprintf(f, "{\n  \"timestamp\": %lld,\n", (long long)time(NULL));
+    if (o->roofline)
+        fprintf(f, "  \"stream\": [{\"threads\": %d, \"n\": %lld, \"copy_gbs\": %.3f, \"triad_gbs\": %.3f}, "
+                   "{\"threads\": %d, \"n\": %lld, \"copy_gbs\": %.3f, \"triad_gbs\": %.3f}],\n",
+                o->bw_one.threads, o->bw_one.n, o->bw_one.copy_gbs, o->bw_one.triad_gbs, o->bw_all.threads,
+                o->bw_all.n, o->bw_all.copy_gbs, o->bw_all.triad_gbs);
+    fprintf(f, "  \"results\": [\n");
+    for (int i = 0; i < n; i++) {
+        fprintf(f, "    {\"matrix\": ");
+        json_str(f, r[i].matrix);
+        fprintf(f, ", \"n_rows\": %d, \"n_cols\": %d, \"nnz\": %d, \"format\": ", r[i].n_rows, r[i].n_cols,
+                r[i].nnz);
+        json_str(f, r[i].format);
+        fprintf(f, ", \"threads\": %d, \"warmup\": %d, \"trials\": %d, \"calls_per_trial\": %d, "
+                   "\"min_ns\": %.1f, \"median_ns\": %.1f, \"p95_ns\": %.1f, \"gflops\": %.4f, "
+                   "\"gbs\": %.4f, \"bytes\": %lld, \"bytes_hi\": %lld, \"ok\": %s, \"roofline\": ",
+                r[i].threads, r[i].warmup, r[i].trials, r[i].calls, r[i].min_ns, r[i].med_ns, r[i].p95_ns,
+                r[i].gflops, r[i].gbs, r[i].bytes, r[i].bytes_hi, r[i].ok ? "true" : "false");
+        if (r[i].have_roof)
+            fprintf(f, "{\"ai\": %.5f, \"peak_gbs\": %.3f, \"roof_gflops\": %.4f, \"frac_peak\": %.4f}",
+                    r[i].ai, r[i].peak_gbs, r[i].roof_gflops, r[i].gbs / r[i].peak_gbs);
+        else
+            fprintf(f, "null");
+        fprintf(f, ", \"counters\": ");
+        if (!r[i].have_ctr) {
+            fprintf(f, "null");
+        } else {
+            fprintf(f, "{");
+            for (int e = 0; e < PC_N; e++) {
+                fprintf(f, "%s\"%s\": ", e ? ", " : "", perf_counter_name(e));
+                if (r[i].ctr.have[e])
+                    fprintf(f, "{\"per_spmv\": %.1f, \"per_nnz\": %.5f}", r[i].ctr.v[e],
+                            r[i].ctr.v[e] / (r[i].nnz ? r[i].nnz : 1));
+                else
+                    fprintf(f, "null");
+            }
+            fprintf(f, "}");
+        }
+        fprintf(f, "}%s\n", i + 1 < n ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    return fclose(f) == 0;
+}
+
+//paths with a comma or quote get quoted
+static int write_csv(const char *path, const drv_result_t *r, int n) {
+    FILE *f = fopen(path, "w");
+    if (!f) return 0;
+    fprintf(f, "matrix,n_rows,n_cols,nnz,format,threads,warmup,trials,calls_per_trial,"
+               "min_ns,median_ns,p95_ns,gflops,gbs,bytes,bytes_hi,ok,ai,peak_gbs,roof_gflops,frac_peak");
+    for (int e = 0; e < PC_N; e++)
+		fprintf(f, ",%s_per_spmv,%s_per_nnz", perf_counter_name(e), perf_counter_name(e));
+    fprintf(f, "\n");
+    for (int i = 0; i < n; i++) {
+        if (strpbrk(r[i].matrix, ",\"\n")) {
+            fputc('"', f);
+            for (const char *s = r[i].matrix; *s; s++) {
+                if (*s == '"') fputc('"', f);
+                fputc(*s, f);
+            }
+            fputc('"', f);
+        } else {
+            fputs(r[i].matrix, f);
+        }
+        fprintf(f, ",%d,%d,%d,%s,%d,%d,%d,%d,%.1f,%.1f,%.1f,%.4f,%.4f,%lld,%lld,%d", r[i].n_rows, r[i].n_cols,
+                r[i].nnz, r[i].format, r[i].threads, r[i].warmup, r[i].trials, r[i].calls, r[i].min_ns,
+                r[i].med_ns, r[i].p95_ns, r[i].gflops, r[i].gbs, r[i].bytes, r[i].bytes_hi, r[i].ok);
+        if (r[i].have_roof)
+            fprintf(f, ",%.5f,%.3f,%.4f,%.4f", r[i].ai, r[i].peak_gbs, r[i].roof_gflops, r[i].gbs / r[i].peak_gbs);
+        else
+            fprintf(f, ",,,,");
+        //empty fields where a counter is missing
+        for (int e = 0; e < PC_N; e++) {
+            if (r[i].have_ctr && r[i].ctr.have[e])
+                fprintf(f, ",%.1f,%.5f", r[i].ctr.v[e], r[i].ctr.v[e] / (r[i].nnz ? r[i].nnz : 1));
+            else
+                fprintf(f, ",,");
+        }
+        fprintf(f, "\n");
+    }
+    return fclose(f) == 0;
+}
+
+static int ends_with(const char *s, const char *suf) {
+    size_t a = strlen(s), b = strlen(suf);
+    return a >= b && strcmp(s + a - b, suf) == 0;
+}
+
+int bench_driver_main(int argc, char **argv) {
+    drv_opts_t o;
+    memset(&o, 0, sizeof(o));
+    o.warmup = 10;
+    o.trials = 30;
+    o.min_trial_ns = 1000000;
+    const char *fmt_arg = "all";
+    const char *thr_arg = NULL;
+
+    int first_path = argc;
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if (arg[0] != '-') { first_path = i; break; }
+        if (strcmp(arg, "-l") == 0) { list_formats(); return 0; }
+        if (strcmp(arg, "-h") == 0) { usage(argv[0]); return 0; }
+        if (strcmp(arg, "-p") == 0) { o.counters = 1; continue; }
+        if (strcmp(arg, "-b") == 0) { o.roofline = 1; continue; }
+        if (strcmp(arg, "-a") == 0) { o.autotune = 1; continue; }
+        if (i + 1 >= argc || strlen(arg) != 2) { usage(argv[0]); return 2; }
+
+        const char *val = argv[++i];
+        switch (arg[1]) {
+        case 'f': fmt_arg = val; break;
+        case 't': thr_arg = val; break;
+        case 'w': o.warmup = atoi(val); break;
+        case 'n': o.trials = atoi(val); break;
+        case 'T': o.min_trial_ns = atoll(val) * 1000LL; break;
+        case 'o': o.out_path = val; break;
+        case 'S': o.save_dir = val; break;
+        case 'M': o.mem_budget = atoll(val) * 1024LL * 1024LL; break;
+        case 'C': o.cache_path = val; break;
+        default: usage(argv[0]); return 2;
+        }
+    }
+    if (first_path >= argc || o.warmup < 0 || o.trials < 1 || o.min_trial_ns < 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    if (!parse_formats(fmt_arg, &o.fmt, &o.n_fmt)) return 2;
+    if (thr_arg) {
+        if (!parse_int_list(thr_arg, &o.threads, &o.n_threads)) {
+            fprintf(stderr, "bad thread list '%s'\n", thr_arg);
+            free(o.fmt);
+            return 2;
+        }
+    } else {
+        o.threads = (int *)malloc(sizeof(int));
+        if (!o.threads) { free(o.fmt); return 1; }
+        o.threads[0] = get_num_threads();
+        o.n_threads = 1;
+    }
+
+    if (o.roofline) {
+        long long n = stream_default_n();
+        int all = get_num_threads();
+        if (bench_stream(n, 1, 5, &o.bw_one) && bench_stream(n, all, 5, &o.bw_all)) {
+            printf("stream n = %lld: 1 thread copy %.1f triad %.1f GB/s, %d threads copy %.1f triad %.1f GB/s\n\n",
+                   n, o.bw_one.copy_gbs, o.bw_one.triad_gbs, all, o.bw_all.copy_gbs, o.bw_all.triad_gbs);
+        } else {
+            printf("stream probe failed, no roofline\n\n");
+            o.roofline = 0;
+        }
+    }
+
+    drv_result_t *res = NULL;
+    int n_res = 0, cap = 0, failed = 0;
+    for (int i = first_path; i < argc; i++)
+		if (!run_matrix(argv[i], &o, &res, &n_res, &cap)) failed = 1;
+
+    for (int i = 0; i < n_res; i++)
+		if (!res[i].ok) failed = 1;
+
+    if (o.out_path) {
+        int w = ends_with(o.out_path, ".csv") ? write_csv(o.out_path, res, n_res)
+                                              : write_json(o.out_path, &o, res, n_res);
+        if (w) printf("wrote %d results to %s\n", n_res, o.out_path);
+        else { fprintf(stderr, "couldn't write %s\n", o.out_path); failed = 1; }
+    }
+
+    free(res);
+    free(o.fmt);
+    free(o.threads);
+    return failed;
+}
@@ -1,5 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <omp.h>
 
 #include "formats.h"
 #include "util.h"
@@ -17,6 +19,33 @@ static int cmp_nnz_desc(const void *a, const void *b) {
     return (pa->idx - pb->idx);
 }
 
+//counting sort by length, longest first and ties by index (same order cmp_nnz_desc gives)
+//active[d] = how many entries are longer than d, i.e. order[0..active[d]) is what is left at depth d
+static int order_by_nnz_desc(const int *len, int n, int max_len, int *order, int *active) {
+    int *start = (int *)calloc((size_t)max_len + 2, sizeof(int));
+    if (!start) return 0;
+
+    for (int i = 0; i < n; i++)
+		start[len[i]]++;
+
+    //start[L] = number of entries longer than L
+    int run = 0;
+    for (int L = max_len; L >= 0; L--) {
+        int c = start[L];
+        start[L] = run;
+        run += c;
+    }
+
+    for (int d = 0; d < max_len; d++)
+		active[d] = start[d];
+
+    for (int i = 0; i < n; i++)
+		order[start[len[i]]++] = i;
+
+    free(start);
+    return 1;
+}
+
 void free_crs(crs_t *a) {
     if (!a) return;
     free(a->values);
@@ -103,6 +132,128 @@ void free_tjds_d(tjds_d_t *a) {
     a->num_tjd = 0;
 }
 
+void free_sell_d(sell_d_t *a) {
+    if (!a) return;
+    free(a->values);
+    free(a->col_idx);
+    free(a->chunk_ptr);
+    free(a->chunk_len);
+    free(a->perm);
+    a->values = NULL;
+    a->col_idx = NULL;
+    a->chunk_ptr = NULL;
+    a->chunk_len = NULL;
+    a->perm = NULL;
+    a->nnz = 0;
+    a->n_chunks = 0;
+}
+
+void free_ell_d(ell_d_t *a) {
+    if (!a) return;
+    free(a->values);
+    free(a->col_idx);
+    a->values = NULL;
+    a->col_idx = NULL;
+    a->nnz = 0;
+    a->width = 0;
+}
+
+void free_hyb_d(hyb_d_t *a) {
+    if (!a) return;
+    free_ell_d(&a->ell);
+    free(a->coo_row);
+    free(a->coo_col);
+    free(a->coo_val);
+    a->coo_row = NULL;
+    a->coo_col = NULL;
+    a->coo_val = NULL;
+    a->coo_nnz = 0;
+    a->nnz = 0;
+}
+
+void free_bcsr_d(bcsr_d_t *a) {
+    if (!a) return;
+    free(a->values);
+    free(a->brow_ptr);
+    free(a->bcol_idx);
+    a->values = NULL;
+    a->brow_ptr = NULL;
+    a->bcol_idx = NULL;
+    a->nnzb = 0;
+}
+
+void free_crs_delta_d(crs_delta_d_t *a) {
+    if (!a) return;
+    free(a->values);
+    free(a->delta);
+    free(a->row_ptr);
+    free(a->base);
+    free(a->esc_row);
+    free(a->esc_col);
+    free(a->esc_val);
+    a->values = NULL;
+    a->delta = NULL;
+    a->row_ptr = NULL;
+    a->base = NULL;
+    a->esc_row = NULL;
+    a->esc_col = NULL;
+    a->esc_val = NULL;
+    a->nnz = 0;
+    a->n_seg = 0;
+    a->n_esc = 0;
+}
+
+void free_crs_f(crs_f_t *a) {
+    if (!a) return;
+    free(a->values);
+    free(a->col_idx);
+    free(a->row_ptr);
+    a->values = NULL;
+    a->col_idx = NULL;
+    a->row_ptr = NULL;
+    a->nnz = 0;
+}
+
+void free_tjds_f(tjds_f_t *a) {
+    if (!a) return;
+    free(a->tjd);
+    free(a->row_idx);
+    free(a->perm);
+    free(a->tjd_ptr);
+    a->tjd = NULL;
+    a->row_idx = NULL;
+    a->perm = NULL;
+    a->tjd_ptr = NULL;
+    a->nnz = 0;
+    a->num_tjd = 0;
+}
+
+void free_crs_sym_d(crs_sym_d_t *a) {
+    if (!a) return;
+    free(a->values);
+    free(a->col_idx);
+    free(a->row_ptr);
+    a->values = NULL;
+    a->col_idx = NULL;
+    a->row_ptr = NULL;
+    a->nnz = 0;
+    a->nnz_full = 0;
+}
+
+void free_jds_d(jds_d_t *a) {
+    if (!a) return;
+    free(a->jdiag);
+    free(a->col_idx);
+    free(a->perm);
+    free(a->jdiag_ptr);
+    a->jdiag = NULL;
+    a->col_idx = NULL;
+    a->perm = NULL;
+    a->jdiag_ptr = NULL;
+    a->nnz = 0;
+    a->num_jd = 0;
+}
+
 crs_t build_crs_from_dense(const int *dense, int n_rows, int n_cols) {
     crs_t a;
     a.n_rows = n_rows;
@@ -588,6 +739,308 @@ int build_ccs_from_triplets_double(int n_rows, int n_cols, const triplet_d_t *t,
     return 1;
 }
 
+//counting transpose, rows come out ascending inside each column
+int build_ccs_from_crs_double(const crs_d_t *c, ccs_d_t *out) {
+    ccs_d_t a;
+    a.n_rows = c->n_rows;
+    a.n_cols = c->n_cols;
+    a.nnz = c->nnz;
+
+    a.values = (double *)malloc((size_t)c->nnz * sizeof(double) + 1);
+    a.row_idx = (int *)malloc((size_t)c->nnz * sizeof(int) + 1);
+    a.col_ptr = (int *)calloc((size_t)c->n_cols + 1, sizeof(int));
+    int *next = (int *)malloc((size_t)c->n_cols * sizeof(int) + 1);
+    if (!a.values || !a.row_idx || !a.col_ptr || !next) {
+        free(next);
+        free_ccs_d(&a);
+        return 0;
+    }
+
+    for (int k = 0; k < c->nnz; k++)
+		a.col_ptr[c->col_idx[k] + 1]++;
+    for (int j = 0; j < c->n_cols; j++)
+		a.col_ptr[j + 1] += a.col_ptr[j];
+    for (int j = 0; j < c->n_cols; j++)
+		next[j] = a.col_ptr[j];
+
+    for (int i = 0; i < c->n_rows; i++) {
+        for (int k = c->row_ptr[i]; k < c->row_ptr[i + 1]; k++) {
+            int pos = next[c->col_idx[k]]++;
+            a.values[pos] = c->values[k];
+            a.row_idx[pos] = i;
+        }
+    }
+
+    free(next);
+    *out = a;
+    return 1;
+}
+
+//by_col = 0 keys on t.i (crs), 1 keys on t.j (ccs)
+//thread t owns triplets [lo_t, hi_t), hist[t][r] turns into the slot offset of thread t inside row r,
+//so every entry lands where the serial builder would put it
+static int build_compressed_par(int n_keys, int n_other, int by_col, const triplet_d_t *t, int nnz, int nthreads,
+                                double *vals, int *idx, int *ptr) {
+    int nt = (nthreads > 0) ? nthreads : get_num_threads();
+    if (nt > nnz) nt = nnz > 0 ? nnz : 1;
+
+    int *hist = (int *)calloc((size_t)nt * (size_t)n_keys, sizeof(int));
+    long long *block_sum = (long long *)calloc((size_t)nt + 1, sizeof(long long));
+    if (!hist || !block_sum) {
+        free(hist); free(block_sum);
+        return 0;
+    }
+
+    int err = 0;
+    ptr[0] = 0;
+
+    #pragma omp parallel num_threads(nt)
+    {
+        //the runtime may hand out fewer threads than asked for (thread limit, dynamic teams), so
+        //everything below splits over the team that actually started
+        int team = omp_get_num_threads();
+        int tid = omp_get_thread_num();
+        int *h = hist + (size_t)tid * (size_t)n_keys;
+        int lo = (int)((long long)nnz * tid / team);
+        int hi = (int)((long long)nnz * (tid + 1) / team);
+        int key_lo = (int)((long long)n_keys * tid / team);
+        int key_hi = (int)((long long)n_keys * (tid + 1) / team);
+
+        for (int k = lo; k < hi; k++) {
+            int r = by_col ? t[k].j : t[k].i;
+            int o = by_col ? t[k].i : t[k].j;
+            if (r < 0 || r >= n_keys || o < 0 || o >= n_other) {
+                #pragma omp atomic write
+                err = 1;
+                break;
+            }
+            h[r]++;
+        }
+        #pragma omp barrier
+
+        //per key: exclusive scan over threads, total count goes to ptr[r + 1]
+        long long local = 0;
+        if (!err) {
+            for (int r = key_lo; r < key_hi; r++) {
+                int run = 0;
+                for (int q = 0; q < team; q++) {
+                    int c = hist[(size_t)q * (size_t)n_keys + r];
+                    hist[(size_t)q * (size_t)n_keys + r] = run;
+                    run += c;
+                }
+                ptr[r + 1] = run;
+                local += run;
+            }
+        }
+        block_sum[tid + 1] = local;
+        #pragma omp barrier
+
+        #pragma omp single
+        {
+            for (int q = 0; q < team; q++)
+				block_sum[q + 1] += block_sum[q];
+        }
+
+        if (!err) {
+            int run = (int)block_sum[tid];
+            for (int r = key_lo; r < key_hi; r++) {
+                run += ptr[r + 1];
+                ptr[r + 1] = run;
+            }
+        }
+        #pragma omp barrier
+
+        if (!err) {
+            for (int k = lo; k < hi; k++) {
+                int r = by_col ? t[k].j : t[k].i;
+                int pos = ptr[r] + h[r]++;
+                vals[pos] = t[k].v;
+                idx[pos] = by_col ? t[k].i : t[k].j;
+            }
+        }
+    }
+
+    free(hist);
+    free(block_sum);
+    return !err;
+}
+
+int build_crs_from_triplets_double_par(int n_rows, int n_cols, const triplet_d_t *t, int nnz, int nthreads, crs_d_t *out) {
+    crs_d_t a;
+    a.n_rows = n_rows;
+    a.n_cols = n_cols;
+    a.nnz = nnz;
+
+    a.values = (double *)malloc((size_t)nnz * sizeof(double));
+    a.col_idx = (int *)malloc((size_t)nnz * sizeof(int));
+    a.row_ptr = (int *)malloc(((size_t)n_rows + 1) * sizeof(int));
+    if (!a.values || !a.col_idx || !a.row_ptr ||
+        !build_compressed_par(n_rows, n_cols, 0, t, nnz, nthreads, a.values, a.col_idx, a.row_ptr)) {
+		free_crs_d(&a);
+		return 0;
+	}
+
+    *out = a;
+    return 1;
+}
+
+int build_ccs_from_triplets_double_par(int n_rows, int n_cols, const triplet_d_t *t, int nnz, int nthreads, ccs_d_t *out) {
+    ccs_d_t a;
+    a.n_rows = n_rows;
+    a.n_cols = n_cols;
+    a.nnz = nnz;
+
+    a.values = (double *)malloc((size_t)nnz * sizeof(double));
+    a.row_idx = (int *)malloc((size_t)nnz * sizeof(int));
+    a.col_ptr = (int *)malloc(((size_t)n_cols + 1) * sizeof(int));
+    if (!a.values || !a.row_idx || !a.col_ptr ||
+        !build_compressed_par(n_cols, n_rows, 1, t, nnz, nthreads, a.values, a.row_idx, a.col_ptr)) {
+		free_ccs_d(&a);
+		return 0;
+	}
+
+    *out = a;
+    return 1;
+}
+
+jds_t build_jds_from_crs(const crs_t *c) {
+    jds_t a;
+    a.n_rows = c->n_rows;
+    a.n_cols = c->n_cols;
+    a.nnz = c->nnz;
+
+    a.num_jd = 0;
+    a.jdiag = NULL;
+    a.col_idx = NULL;
+    a.perm = NULL;
+    a.jdiag_ptr = NULL;
+
+    int n_rows = c->n_rows;
+
+    int *row_nnz = (int *)malloc((size_t)n_rows * sizeof(int));
+    if (!row_nnz) return a;
+
+    for (int i = 0; i < n_rows; i++) {
+        int count = c->row_ptr[i + 1] - c->row_ptr[i];
+        row_nnz[i] = count;
+        if (count > a.num_jd) a.num_jd = count;
+    }
+
+    a.perm = (int *)malloc((size_t)n_rows * sizeof(int));
+    a.jdiag = (int *)malloc((size_t)a.nnz * sizeof(int));
+    a.col_idx = (int *)malloc((size_t)a.nnz * sizeof(int));
+    a.jdiag_ptr = (int *)malloc((size_t)(a.num_jd + 1) * sizeof(int));
+    if (!a.perm || !a.jdiag || !a.col_idx || !a.jdiag_ptr ||
+        !order_by_nnz_desc(row_nnz, n_rows, a.num_jd, a.perm, a.jdiag_ptr + 1)) {
+        free(row_nnz);
+        free_jds(&a);
+        return a;
+    }
+
+    a.jdiag_ptr[0] = 0;
+    for (int d = 0; d < a.num_jd; d++)
+		a.jdiag_ptr[d + 1] += a.jdiag_ptr[d];
+
+    //row_nnz is free now, keep the start of each packed row in it
+    int *base = row_nnz;
+    for (int r = 0; r < n_rows; r++)
+		base[r] = c->row_ptr[a.perm[r]];
+
+    //rows are sorted longest first, so depth d only touches the first len rows
+    for (int d = 0; d < a.num_jd; d++) {
+        int start = a.jdiag_ptr[d];
+        int len = a.jdiag_ptr[d + 1] - start;
+        for (int r = 0; r < len; r++) {
+            int src = base[r] + d;
+            a.jdiag[start + r] = c->values[src];
+            a.col_idx[start + r] = c->col_idx[src];
+        }
+    }
+
+    free(row_nnz);
+    return a;
+}
+
+//same steps as build_jds_from_crs
+int build_jds_from_crs_double(const crs_d_t *c, jds_d_t *out) {
+    jds_d_t a;
+    a.n_rows = c->n_rows;
+    a.n_cols = c->n_cols;
+    a.nnz = c->nnz;
+    a.num_jd = 0;
+
+    int n_rows = c->n_rows;
+    int *row_nnz = (int *)malloc((size_t)n_rows * sizeof(int) + 1);
+    if (!row_nnz) return 0;
+
+    for (int i = 0; i < n_rows; i++) {
+        int count = c->row_ptr[i + 1] - c->row_ptr[i];
+        row_nnz[i] = count;
+        if (count > a.num_jd) a.num_jd = count;
+    }
+
+    a.perm = (int *)malloc((size_t)n_rows * sizeof(int) + 1);
+    a.jdiag = (double *)malloc((size_t)a.nnz * sizeof(double) + 1);
+    a.col_idx = (int *)malloc((size_t)a.nnz * sizeof(int) + 1);
+    a.jdiag_ptr = (int *)malloc((size_t)(a.num_jd + 1) * sizeof(int));
+    if (!a.perm || !a.jdiag || !a.col_idx || !a.jdiag_ptr ||
+        !order_by_nnz_desc(row_nnz, n_rows, a.num_jd, a.perm, a.jdiag_ptr + 1)) {
+        free(row_nnz);
+        free_jds_d(&a);
+        return 0;
+    }
+
+    a.jdiag_ptr[0] = 0;
+    for (int d = 0; d < a.num_jd; d++)
+		a.jdiag_ptr[d + 1] += a.jdiag_ptr[d];
+
+    int *base = row_nnz;
+    for (int r = 0; r < n_rows; r++)
+		base[r] = c->row_ptr[a.perm[r]];
+
+    for (int d = 0; d < a.num_jd; d++) {
+        int start = a.jdiag_ptr[d];
+        int len = a.jdiag_ptr[d + 1] - start;
+        for (int r = 0; r < len; r++) {
+            int src = base[r] + d;
+            a.jdiag[start + r] = c->values[src];
+            a.col_idx[start + r] = c->col_idx[src];
+        }
+    }
+
+    free(row_nnz);
+    *out = a;
+    return 1;
+}
+
+int build_jds_from_triplets(int n_rows, int n_cols, const triplet_t *t, int nnz, jds_t *out) {
+    crs_t crs;
+    if (!build_crs_from_triplets(n_rows, n_cols, t, nnz, &crs))
+		return 0;
+
+    jds_t a = build_jds_from_crs(&crs);
+    free_crs(&crs);
+    if (!a.perm && n_rows > 0)
+		return 0;
+
+    *out = a;
+    return 1;
+}
+
+int build_tjds_from_triplets(int n_rows, int n_cols, const triplet_t *t, int nnz, tjds_t *out) {
+    ccs_t ccs;
+    if (!build_ccs_from_triplets(n_rows, n_cols, t, nnz, &ccs))
+		return 0;
+
+    tjds_t a = build_tjds_from_ccs(&ccs);
+    free_ccs(&ccs);
+    if (!a.perm && n_cols > 0)
+		return 0;
+
+    *out = a;
+    return 1;
+}
+
 tjds_t build_tjds_from_ccs(const ccs_t *c) {
     tjds_t a;
     a.n_rows = c->n_rows;
@@ -603,69 +1056,106 @@ tjds_t build_tjds_from_ccs(const ccs_t *c) {
     int n_cols = c->n_cols;
 
     int *col_nnz = (int *)malloc((size_t)n_cols * sizeof(int));
-    int *order = (int *)malloc((size_t)n_cols * sizeof(int));
-    if (!col_nnz || !order) {
-		free(col_nnz); free(order); return a;
-	}
+    if (!col_nnz) return a;
 
     for (int j = 0; j < n_cols; j++) {
         int count = c->col_ptr[j + 1] - c->col_ptr[j];
         col_nnz[j] = count;
-        order[j] = j;
         if (count > a.num_tjd) a.num_tjd = count;
     }
 
-	nnz_pair_t *pairs = malloc((size_t)n_cols * sizeof(nnz_pair_t));
-	if (!pairs) { free(col_nnz); free(order); return a; }
+    a.perm = (int *)malloc((size_t)n_cols * sizeof(int));
+    a.tjd = (int *)malloc((size_t)a.nnz * sizeof(int));
+    a.row_idx = (int *)malloc((size_t)a.nnz * sizeof(int));
+    a.tjd_ptr = (int *)malloc((size_t)(a.num_tjd + 1) * sizeof(int));
+    if (!a.perm || !a.tjd || !a.row_idx || !a.tjd_ptr ||
+        !order_by_nnz_desc(col_nnz, n_cols, a.num_tjd, a.perm, a.tjd_ptr + 1)) {
+        free(col_nnz);
+        free_tjds(&a);
+        return a;
+    }
 
-	for (int j = 0; j < n_cols; j++) {
-		pairs[j].idx = j;
-		pairs[j].nnz = col_nnz[j];
-	}
+    a.tjd_ptr[0] = 0;
+    for (int d = 0; d < a.num_tjd; d++)
+		a.tjd_ptr[d + 1] += a.tjd_ptr[d];
 
-	qsort(pairs, (size_t)n_cols, sizeof(nnz_pair_t), cmp_nnz_desc);
+    int *base = col_nnz;
+    for (int cidx = 0; cidx < n_cols; cidx++)
+		base[cidx] = c->col_ptr[a.perm[cidx]];
 
-	for (int j = 0; j < n_cols; j++)
-		order[j] = pairs[j].idx;
+    //columns are sorted longest first, so depth d stops at the last column still active
+    for (int d = 0; d < a.num_tjd; d++) {
+        int start = a.tjd_ptr[d];
+        int len = a.tjd_ptr[d + 1] - start;
+        for (int cidx = 0; cidx < len; cidx++) {
+            int src = base[cidx] + d;
+            a.tjd[start + cidx] = c->values[src];
+            a.row_idx[start + cidx] = c->row_idx[src];
+        }
+    }
 
-	free(pairs);
+    free(col_nnz);
+    return a;
+}
+
+tjds_d_t build_tjds_from_ccs_double(const ccs_d_t *c) {
+    tjds_d_t a;
+    a.n_rows = c->n_rows;
+    a.n_cols = c->n_cols;
+    a.nnz = c->nnz;
+
+    a.num_tjd = 0;
+    a.tjd = NULL;
+    a.row_idx = NULL;
+    a.perm = NULL;
+    a.tjd_ptr = NULL;
+
+    int n_cols = c->n_cols;
+
+    int *col_nnz = (int *)malloc((size_t)n_cols * sizeof(int));
+    if (!col_nnz) return a;
 
+    for (int j = 0; j < n_cols; j++) {
+        int count = c->col_ptr[j + 1] - c->col_ptr[j];
+        col_nnz[j] = count;
+        if (count > a.num_tjd) a.num_tjd = count;
+    }
 
     a.perm = (int *)malloc((size_t)n_cols * sizeof(int));
-    a.tjd = (int *)malloc((size_t)a.nnz * sizeof(int));
+    a.tjd = (double *)malloc((size_t)a.nnz * sizeof(double));
     a.row_idx = (int *)malloc((size_t)a.nnz * sizeof(int));
     a.tjd_ptr = (int *)malloc((size_t)(a.num_tjd + 1) * sizeof(int));
-    if (!a.perm || !a.tjd || !a.row_idx || !a.tjd_ptr) {
-        free(col_nnz); free(order);
-        free_tjds(&a);
+    if (!a.perm || !a.tjd || !a.row_idx || !a.tjd_ptr ||
+        !order_by_nnz_desc(col_nnz, n_cols, a.num_tjd, a.perm, a.tjd_ptr + 1)) {
+        free(col_nnz);
+        free_tjds_d(&a);
         return a;
     }
 
-    for (int cidx = 0; cidx < n_cols; cidx++)
-		a.perm[cidx] = order[cidx];
-
-    int k = 0;
     a.tjd_ptr[0] = 0;
+    for (int d = 0; d < a.num_tjd; d++)
+		a.tjd_ptr[d + 1] += a.tjd_ptr[d];
+
+    int *base = col_nnz;
+    for (int cidx = 0; cidx < n_cols; cidx++)
+		base[cidx] = c->col_ptr[a.perm[cidx]];
 
     for (int d = 0; d < a.num_tjd; d++) {
-        for (int cidx = 0; cidx < n_cols; cidx++) {
-            int orig_col = a.perm[cidx];
-            if (d < col_nnz[orig_col]) {
-                int base = c->col_ptr[orig_col];
-                a.tjd[k] = c->values[base + d];
-                a.row_idx[k] = c->row_idx[base + d];
-                k++;
-            }
+        int start = a.tjd_ptr[d];
+        int len = a.tjd_ptr[d + 1] - start;
+        for (int cidx = 0; cidx < len; cidx++) {
+            int src = base[cidx] + d;
+            a.tjd[start + cidx] = c->values[src];
+            a.row_idx[start + cidx] = c->row_idx[src];
         }
-        a.tjd_ptr[d + 1] = k;
     }
 
     free(col_nnz);
-    free(order);
     return a;
 }
 
-tjds_d_t build_tjds_from_ccs_double(const ccs_d_t *c) {
+//original qsort + depth x all columns scan, O(num_tjd * n_cols), kept for the build benchmark
+tjds_d_t build_tjds_from_ccs_double_ref(const ccs_d_t *c) {
     tjds_d_t a;
     a.n_rows = c->n_rows;
     a.n_cols = c->n_cols;
@@ -741,6 +1231,635 @@ tjds_d_t build_tjds_from_ccs_double(const ccs_d_t *c) {
     return a;
 }
 
+//64 byte aligned so the chunk columns line up with vector loads
+static void *alloc_aligned64(size_t bytes) {
+    size_t rounded = (bytes + 63) & ~(size_t)63;
+    return aligned_alloc(64, rounded ? rounded : 64);
+}
+
+int build_sell_from_crs_double(const crs_d_t *c, int C, int sigma, sell_d_t *out) {
+    if (C < 1 || C > 16) return 0;
+    if (sigma < 1) sigma = 1;
+
+    sell_d_t a;
+    a.n_rows = c->n_rows;
+    a.n_cols = c->n_cols;
+    a.nnz = c->nnz;
+    a.C = C;
+    a.sigma = sigma;
+    a.n_chunks = (c->n_rows + C - 1) / C;
+    a.values = NULL;
+    a.col_idx = NULL;
+    a.chunk_ptr = (int *)malloc((size_t)(a.n_chunks + 1) * sizeof(int));
+    a.chunk_len = (int *)malloc((size_t)a.n_chunks * sizeof(int) + 1);
+    a.perm = (int *)malloc((size_t)a.n_chunks * (size_t)C * sizeof(int) + 1);
+    nnz_pair_t *pairs = malloc((size_t)c->n_rows * sizeof(nnz_pair_t) + 1);
+    if (!a.chunk_ptr || !a.chunk_len || !a.perm || !pairs) {
+        free(pairs);
+        free_sell_d(&a);
+        return 0;
+    }
+
+    for (int i = 0; i < c->n_rows; i++) {
+        pairs[i].idx = i;
+        pairs[i].nnz = c->row_ptr[i + 1] - c->row_ptr[i];
+    }
+    if (sigma > 1) {
+        for (int w = 0; w < c->n_rows; w += sigma) {
+            int len = (w + sigma <= c->n_rows) ? sigma : c->n_rows - w;
+            qsort(pairs + w, (size_t)len, sizeof(nnz_pair_t), cmp_nnz_desc);
+        }
+    }
+
+    //rows past n_rows in the last chunk are empty and get perm -1
+    long long slots = 0;
+    for (int ch = 0; ch < a.n_chunks; ch++) {
+        int width = 0;
+        for (int l = 0; l < C; l++) {
+            int r = ch * C + l;
+            if (r < c->n_rows) {
+                a.perm[r] = pairs[r].idx;
+                if (pairs[r].nnz > width) width = pairs[r].nnz;
+            } else {
+                a.perm[r] = -1;
+            }
+        }
+        a.chunk_len[ch] = width;
+        a.chunk_ptr[ch] = (int)slots;
+        slots += (long long)width * C;
+    }
+    a.chunk_ptr[a.n_chunks] = (int)slots;
+    free(pairs);
+
+    if (slots > 0x7fffffffLL) {
+        free_sell_d(&a);
+        return 0;
+    }
+
+    a.values = (double *)alloc_aligned64((size_t)slots * sizeof(double));
+    a.col_idx = (int *)alloc_aligned64((size_t)slots * sizeof(int));
+    if (!a.values || !a.col_idx) {
+        free_sell_d(&a);
+        return 0;
+    }
+
+    for (int ch = 0; ch < a.n_chunks; ch++) {
+        int base = a.chunk_ptr[ch];
+        for (int l = 0; l < C; l++) {
+            int r = ch * C + l;
+            int orig = a.perm[r];
+            int k0 = (orig >= 0) ? c->row_ptr[orig] : 0;
+            int len = (orig >= 0) ? c->row_ptr[orig + 1] - k0 : 0;
+            int pad_col = (len > 0) ? c->col_idx[k0 + len - 1] : 0;
+
+            for (int j = 0; j < a.chunk_len[ch]; j++) {
+                int slot = base + j * C + l;
+                if (j < len) {
+                    a.values[slot] = c->values[k0 + j];
+                    a.col_idx[slot] = c->col_idx[k0 + j];
+                } else {
+                    a.values[slot] = 0.0;
+                    a.col_idx[slot] = pad_col;
+                }
+            }
+        }
+    }
+
+    *out = a;
+    return 1;
+}
+
+long long sell_count_slots(const crs_d_t *c, int C, int sigma) {
+    if (C < 1 || C > 16) return -1;
+    if (sigma < 1) sigma = 1;
+
+    nnz_pair_t *pairs = malloc((size_t)c->n_rows * sizeof(nnz_pair_t) + 1);
+    if (!pairs) return -1;
+    for (int i = 0; i < c->n_rows; i++) {
+        pairs[i].idx = i;
+        pairs[i].nnz = c->row_ptr[i + 1] - c->row_ptr[i];
+    }
+    if (sigma > 1) {
+        for (int w = 0; w < c->n_rows; w += sigma) {
+            int len = (w + sigma <= c->n_rows) ? sigma : c->n_rows - w;
+            qsort(pairs + w, (size_t)len, sizeof(nnz_pair_t), cmp_nnz_desc);
+        }
+    }
+
+    long long slots = 0;
+    for (int r0 = 0; r0 < c->n_rows; r0 += C) {
+        int width = 0;
+        for (int r = r0; r < r0 + C && r < c->n_rows; r++)
+			if (pairs[r].nnz > width) width = pairs[r].nnz;
+        slots += (long long)width * C;
+    }
+    free(pairs);
+    return slots;
+}
+
+double sell_padding_ratio(const sell_d_t *a) {
+    if (a->nnz == 0) return 1.0;
+    return (double)a->chunk_ptr[a->n_chunks] / (double)a->nnz;
+}
+
+//rows longer than width leave their tail out, caller puts it somewhere else
+static int fill_ell_from_crs(const crs_d_t *c, int width, ell_d_t *out) {
+    ell_d_t a;
+    a.n_rows = c->n_rows;
+    a.n_cols = c->n_cols;
+    a.width = width;
+    a.nnz = 0;
+
+    size_t slots = (size_t)c->n_rows * (size_t)width;
+    a.values = (double *)alloc_aligned64(slots * sizeof(double));
+    a.col_idx = (int *)alloc_aligned64(slots * sizeof(int));
+    if (!a.values || !a.col_idx) {
+        free_ell_d(&a);
+        return 0;
+    }
+
+    for (int i = 0; i < c->n_rows; i++) {
+        int k0 = c->row_ptr[i];
+        int len = c->row_ptr[i + 1] - k0;
+        int pad_col = (len > 0) ? c->col_idx[k0 + (len < width ? len : width) - 1] : 0;
+
+        for (int j = 0; j < width; j++) {
+            size_t slot = (size_t)j * (size_t)c->n_rows + (size_t)i;
+            if (j < len) {
+                a.values[slot] = c->values[k0 + j];
+                a.col_idx[slot] = c->col_idx[k0 + j];
+                a.nnz++;
+            } else {
+                a.values[slot] = 0.0;
+                a.col_idx[slot] = pad_col;
+            }
+        }
+    }
+
+    *out = a;
+    return 1;
+}
+
+int crs_max_row_len(const crs_d_t *c) {
+    int w = 0;
+    for (int i = 0; i < c->n_rows; i++) {
+        int len = c->row_ptr[i + 1] - c->row_ptr[i];
+        if (len > w) w = len;
+    }
+    return w;
+}
+
+int build_ell_from_crs_double(const crs_d_t *c, ell_d_t *out) {
+    int width = crs_max_row_len(c);
+    if ((long long)c->n_rows * width > (long long)ELL_MAX_PAD * c->nnz) return 0;
+    return fill_ell_from_crs(c, width, out);
+}
+
+int hyb_choose_width(const crs_d_t *c) {
+    int max_len = crs_max_row_len(c);
+
+    int *hist = (int *)calloc((size_t)max_len + 1, sizeof(int));
+    if (!hist) return 0;
+    for (int i = 0; i < c->n_rows; i++)
+		hist[c->row_ptr[i + 1] - c->row_ptr[i]]++;
+
+    //rows_ge = rows with at least K + 1 entries
+    int K = 0;
+    long long rows_ge = c->n_rows - hist[0];
+    while (K < max_len && rows_ge * 3 >= c->n_rows) {
+        K++;
+        rows_ge -= hist[K];
+    }
+
+    free(hist);
+    return K;
+}
+
+int build_hyb_from_crs_double(const crs_d_t *c, int K, hyb_d_t *out) {
+    if (K < 0) K = hyb_choose_width(c);
+
+    hyb_d_t a;
+    a.n_rows = c->n_rows;
+    a.n_cols = c->n_cols;
+    a.nnz = c->nnz;
+    a.coo_nnz = 0;
+    a.coo_row = NULL;
+    a.coo_col = NULL;
+    a.coo_val = NULL;
+
+    if (!fill_ell_from_crs(c, K, &a.ell)) return 0;
+
+    a.coo_nnz = c->nnz - a.ell.nnz;
+    a.coo_row = (int *)malloc((size_t)a.coo_nnz * sizeof(int) + 1);
+    a.coo_col = (int *)malloc((size_t)a.coo_nnz * sizeof(int) + 1);
+    a.coo_val = (double *)malloc((size_t)a.coo_nnz * sizeof(double) + 1);
+    if (!a.coo_row || !a.coo_col || !a.coo_val) {
+        free_hyb_d(&a);
+        return 0;
+    }
+
+    //overflow in row order, so the coo loop walks y forward
+    int p = 0;
+    for (int i = 0; i < c->n_rows; i++) {
+        for (int k = c->row_ptr[i] + K; k < c->row_ptr[i + 1]; k++) {
+            a.coo_row[p] = i;
+            a.coo_col[p] = c->col_idx[k];
+            a.coo_val[p] = c->values[k];
+            p++;
+        }
+    }
+
+    *out = a;
+    return 1;
+}
+
+double ell_padding_ratio(const ell_d_t *a) {
+    if (a->nnz == 0) return 1.0;
+    return (double)a->n_rows * (double)a->width / (double)a->nnz;
+}
+
+static int cmp_int_asc(const void *a, const void *b) {
+    int x = *(const int *)a;
+    int y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+//distinct block columns of block row br, stamp[] holds the last block row that saw each one
+static int bcsr_count_brow(const crs_d_t *a, int r, int c, int br, int *stamp, int *list) {
+    int n = 0;
+    int i1 = (br + 1) * r < a->n_rows ? (br + 1) * r : a->n_rows;
+    for (int i = br * r; i < i1; i++) {
+        for (int k = a->row_ptr[i]; k < a->row_ptr[i + 1]; k++) {
+            int bc = a->col_idx[k] / c;
+            if (stamp[bc] != br) {
+                stamp[bc] = br;
+                if (list) list[n] = bc;
+                n++;
+            }
+        }
+    }
+    return n;
+}
+
+double bcsr_estimate_fill(const crs_d_t *a, int r, int c, int step) {
+    if (step < 1) step = 1;
+    int n_brows = (a->n_rows + r - 1) / r;
+    int n_bcols = (a->n_cols + c - 1) / c;
+    int *stamp = (int *)malloc((size_t)n_bcols * sizeof(int) + 1);
+    if (!stamp) return 0.0;
+    for (int j = 0; j < n_bcols; j++) stamp[j] = -1;
+
+    long long blocks = 0, nz = 0;
+    for (int br = 0; br < n_brows; br += step) {
+        blocks += bcsr_count_brow(a, r, c, br, stamp, NULL);
+        int i1 = (br + 1) * r < a->n_rows ? (br + 1) * r : a->n_rows;
+        nz += a->row_ptr[i1] - a->row_ptr[br * r];
+    }
+    free(stamp);
+
+    if (nz == 0) return 1.0;
+    return (double)blocks * r * c / (double)nz;
+}
+
+//without a profile the cost per nnz is the 8 byte value and 4 byte index per block slot,
+//both times the fill (lower is better, so it is negated to share the max below)
+void bcsr_choose_block(const crs_d_t *a, int step, double prof[4][4], int *r, int *c, double fill[4][4]) {
+    double best = 0.0;
+    *r = 1;
+    *c = 1;
+    for (int rr = 1; rr <= 4; rr++) {
+        for (int cc = 1; cc <= 4; cc++) {
+            double f = (rr <= a->n_rows && cc <= a->n_cols) ? bcsr_estimate_fill(a, rr, cc, step) : 0.0;
+            if (fill) fill[rr - 1][cc - 1] = f;
+            if (f <= 0.0) continue;
+
+            double score = prof ? prof[rr - 1][cc - 1] / f : -f * (8.0 + 4.0 / (rr * cc));
+            if (best == 0.0 || score > best) {
+                best = score;
+                *r = rr;
+                *c = cc;
+            }
+        }
+    }
+}
+
+int build_bcsr_from_crs_double(const crs_d_t *a, int r, int c, bcsr_d_t *out) {
+    if (r < 1 || r > 4 || c < 1 || c > 4 || r > a->n_rows || c > a->n_cols) return 0;
+
+    bcsr_d_t b;
+    b.n_rows = a->n_rows;
+    b.n_cols = a->n_cols;
+    b.nnz = a->nnz;
+    b.r = r;
+    b.c = c;
+    b.n_brows = (a->n_rows + r - 1) / r;
+    b.nnzb = 0;
+    b.values = NULL;
+    b.bcol_idx = NULL;
+    b.brow_ptr = (int *)malloc((size_t)(b.n_brows + 1) * sizeof(int));
+
+    int n_bcols = (a->n_cols + c - 1) / c;
+    int *stamp = (int *)malloc((size_t)n_bcols * sizeof(int) + 1);
+    int *slot = (int *)malloc((size_t)n_bcols * sizeof(int) + 1);
+    if (!b.brow_ptr || !stamp || !slot) {
+        free(stamp); free(slot);
+        free_bcsr_d(&b);
+        return 0;
+    }
+
+    //pass 1: blocks per block row
+    for (int j = 0; j < n_bcols; j++) stamp[j] = -1;
+    long long total = 0;
+    b.brow_ptr[0] = 0;
+    for (int br = 0; br < b.n_brows; br++) {
+        total += bcsr_count_brow(a, r, c, br, stamp, NULL);
+        if (total * r * c > 0x7fffffffLL) {
+            free(stamp); free(slot);
+            free_bcsr_d(&b);
+            return 0;
+        }
+        b.brow_ptr[br + 1] = (int)total;
+    }
+    b.nnzb = (int)total;
+
+    b.values = (double *)alloc_aligned64((size_t)b.nnzb * r * c * sizeof(double));
+    b.bcol_idx = (int *)malloc((size_t)b.nnzb * sizeof(int) + 1);
+    if (!b.values || !b.bcol_idx) {
+        free(stamp); free(slot);
+        free_bcsr_d(&b);
+        return 0;
+    }
+    for (size_t k = 0; k < (size_t)b.nnzb * r * c; k++) b.values[k] = 0.0;
+
+    //pass 2: block columns sorted so x is walked forward, then scatter the values. += on the zeroed
+    //blocks so repeated (i, j) entries sum like they do in crs
+    for (int j = 0; j < n_bcols; j++) stamp[j] = -1;
+    int last_col0 = a->n_cols - c;
+    for (int br = 0; br < b.n_brows; br++) {
+        int p0 = b.brow_ptr[br];
+        int n = bcsr_count_brow(a, r, c, br, stamp, b.bcol_idx + p0);
+        qsort(b.bcol_idx + p0, (size_t)n, sizeof(int), cmp_int_asc);
+        for (int q = 0; q < n; q++) {
+            slot[b.bcol_idx[p0 + q]] = p0 + q;
+            int col0 = b.bcol_idx[p0 + q] * c;
+            b.bcol_idx[p0 + q] = col0 < last_col0 ? col0 : last_col0;
+        }
+
+        int i1 = (br + 1) * r < a->n_rows ? (br + 1) * r : a->n_rows;
+        for (int i = br * r; i < i1; i++) {
+            for (int k = a->row_ptr[i]; k < a->row_ptr[i + 1]; k++) {
+                int j = a->col_idx[k];
+                int blk = slot[j / c];
+                b.values[(size_t)blk * r * c + (size_t)(i - br * r) * c + (j - b.bcol_idx[blk])] += a->values[k];
+            }
+        }
+    }
+
+    free(stamp);
+    free(slot);
+    *out = b;
+    return 1;
+}
+
+long long bcsr_bytes(const bcsr_d_t *a) {
+    spmv_traffic_t t;
+    bcsr_d_traffic(a, &t);
+    return traffic_lo(&t);
+}
+
+//base of one segment: the lowest column that starts the widest UINT16_MAX window, so as few
+//entries as possible escape. cols is sorted in place
+static int crs_delta_base(int *cols, int n) {
+    qsort(cols, (size_t)n, sizeof(int), cmp_int_asc);
+    int best = 0, best_n = 0;
+    for (int lo = 0, hi = 0; lo < n; lo++) {
+        while (hi < n && (long long)cols[hi] - cols[lo] <= UINT16_MAX) hi++;
+        if (hi - lo > best_n) {
+            best_n = hi - lo;
+            best = lo;
+        }
+    }
+    return n ? cols[best] : 0;
+}
+
+static int crs_delta_fits(int col, int base) {
+    return col >= base && (long long)col - base <= UINT16_MAX;
+}
+
+int build_crs_delta_from_crs_double(const crs_d_t *a, crs_delta_d_t *out) {
+    crs_delta_d_t d;
+    d.n_rows = a->n_rows;
+    d.n_cols = a->n_cols;
+    d.nnz = a->nnz;
+    d.n_seg = (a->nnz + CRS_DELTA_SEG - 1) / CRS_DELTA_SEG;
+    d.n_esc = 0;
+    d.values = (double *)malloc((size_t)a->nnz * sizeof(double) + 1);
+    d.delta = (uint16_t *)malloc((size_t)a->nnz * sizeof(uint16_t) + 1);
+    d.row_ptr = (int *)malloc((size_t)(a->n_rows + 1) * sizeof(int));
+    d.base = (int *)malloc((size_t)d.n_seg * sizeof(int) + 1);
+    d.esc_row = NULL;
+    d.esc_col = NULL;
+    d.esc_val = NULL;
+    if (!d.values || !d.delta || !d.row_ptr || !d.base) {
+        free_crs_delta_d(&d);
+        return 0;
+    }
+
+    //pass 1 picks the bases and counts escapes so the esc lists are allocated once
+    int cols[CRS_DELTA_SEG];
+    for (int s = 0; s < d.n_seg; s++) {
+        int k0 = s * CRS_DELTA_SEG;
+        int n = (a->nnz - k0 < CRS_DELTA_SEG) ? a->nnz - k0 : CRS_DELTA_SEG;
+        memcpy(cols, a->col_idx + k0, (size_t)n * sizeof(int));
+        d.base[s] = crs_delta_base(cols, n);
+        for (int k = k0; k < k0 + n; k++)
+			if (!crs_delta_fits(a->col_idx[k], d.base[s])) d.n_esc++;
+    }
+    d.esc_row = (int *)malloc((size_t)d.n_esc * sizeof(int) + 1);
+    d.esc_col = (int *)malloc((size_t)d.n_esc * sizeof(int) + 1);
+    d.esc_val = (double *)malloc((size_t)d.n_esc * sizeof(double) + 1);
+    if (!d.esc_row || !d.esc_col || !d.esc_val) {
+        free_crs_delta_d(&d);
+        return 0;
+    }
+
+    int e = 0;
+    for (int i = 0; i <= a->n_rows; i++) d.row_ptr[i] = a->row_ptr[i];
+    for (int i = 0; i < a->n_rows; i++) {
+        for (int k = a->row_ptr[i]; k < a->row_ptr[i + 1]; k++) {
+            int base = d.base[k / CRS_DELTA_SEG];
+            if (crs_delta_fits(a->col_idx[k], base)) {
+                d.delta[k] = (uint16_t)(a->col_idx[k] - base);
+                d.values[k] = a->values[k];
+            } else {
+                d.delta[k] = 0;
+                d.values[k] = 0.0;
+                d.esc_row[e] = i;
+                d.esc_col[e] = a->col_idx[k];
+                d.esc_val[e] = a->values[k];
+                e++;
+            }
+        }
+    }
+
+    *out = d;
+    return 1;
+}
+
+long long crs_d_bytes(const crs_d_t *a) {
+    spmv_traffic_t t;
+    crs_d_traffic(a, &t);
+    return traffic_lo(&t);
+}
+
+long long crs_delta_bytes(const crs_delta_d_t *a) {
+    spmv_traffic_t t;
+    crs_delta_traffic(a, &t);
+    return traffic_lo(&t);
+}
+
+static int *dup_ints(const int *src, size_t n) {
+    int *p = (int *)malloc(n * sizeof(int) + 1);
+    if (p) memcpy(p, src, n * sizeof(int));
+    return p;
+}
+
+int crs_d_to_f(const crs_d_t *a, crs_f_t *out) {
+    crs_f_t f;
+    f.n_rows = a->n_rows;
+    f.n_cols = a->n_cols;
+    f.nnz = a->nnz;
+    f.values = (float *)malloc((size_t)a->nnz * sizeof(float) + 1);
+    f.col_idx = dup_ints(a->col_idx, (size_t)a->nnz);
+    f.row_ptr = dup_ints(a->row_ptr, (size_t)a->n_rows + 1);
+    if (!f.values || !f.col_idx || !f.row_ptr) {
+        free_crs_f(&f);
+        return 0;
+    }
+    for (int k = 0; k < a->nnz; k++) f.values[k] = (float)a->values[k];
+
+    *out = f;
+    return 1;
+}
+
+int tjds_d_to_f(const tjds_d_t *a, tjds_f_t *out) {
+    tjds_f_t f;
+    f.n_rows = a->n_rows;
+    f.n_cols = a->n_cols;
+    f.nnz = a->nnz;
+    f.num_tjd = a->num_tjd;
+    f.tjd = (float *)malloc((size_t)a->nnz * sizeof(float) + 1);
+    f.row_idx = dup_ints(a->row_idx, (size_t)a->nnz);
+    f.perm = dup_ints(a->perm, (size_t)a->n_cols);
+    f.tjd_ptr = dup_ints(a->tjd_ptr, (size_t)a->num_tjd + 1);
+    if (!f.tjd || !f.row_idx || !f.perm || !f.tjd_ptr) {
+        free_tjds_f(&f);
+        return 0;
+    }
+    for (int k = 0; k < a->nnz; k++) f.tjd[k] = (float)a->tjd[k];
+
+    *out = f;
+    return 1;
+}
+
+int build_crs_sym_from_crs_double(const crs_d_t *a, int skew, crs_sym_d_t *out) {
+    if (a->n_rows != a->n_cols) return 0;
+
+    crs_sym_d_t s;
+    s.n = a->n_rows;
+    s.skew = skew ? 1 : 0;
+    s.nnz = 0;
+    s.nnz_full = 0;
+    s.values = NULL;
+    s.col_idx = NULL;
+    s.row_ptr = (int *)malloc((size_t)(s.n + 1) * sizeof(int));
+    if (!s.row_ptr) return 0;
+
+    s.row_ptr[0] = 0;
+    for (int i = 0; i < s.n; i++) {
+        for (int k = a->row_ptr[i]; k < a->row_ptr[i + 1]; k++) {
+            int j = a->col_idx[k];
+            if (s.skew && j == i && a->values[k] != 0.0) {
+                free(s.row_ptr);
+                return 0;
+            }
+            if (j < i) { s.nnz++; s.nnz_full += 2; }
+            else if (j == i && !s.skew) { s.nnz++; s.nnz_full++; }
+        }
+        s.row_ptr[i + 1] = s.nnz;
+    }
+
+    s.values = (double *)malloc((size_t)s.nnz * sizeof(double) + 1);
+    s.col_idx = (int *)malloc((size_t)s.nnz * sizeof(int) + 1);
+    if (!s.values || !s.col_idx) {
+        free_crs_sym_d(&s);
+        return 0;
+    }
+
+    int p = 0;
+    for (int i = 0; i < s.n; i++) {
+        for (int k = a->row_ptr[i]; k < a->row_ptr[i + 1]; k++) {
+            if (a->col_idx[k] > i || (s.skew && a->col_idx[k] == i)) continue;
+            s.values[p] = a->values[k];
+            s.col_idx[p] = a->col_idx[k];
+            p++;
+        }
+    }
+
+    *out = s;
+    return 1;
+}
+
+int crs_sym_expand_double(const crs_sym_d_t *a, crs_d_t *out) {
+    crs_d_t c;
+    c.n_rows = a->n;
+    c.n_cols = a->n;
+    c.nnz = a->nnz_full;
+    c.values = (double *)malloc((size_t)a->nnz_full * sizeof(double) + 1);
+    c.col_idx = (int *)malloc((size_t)a->nnz_full * sizeof(int) + 1);
+    c.row_ptr = (int *)calloc((size_t)a->n + 1, sizeof(int));
+    int *next = (int *)malloc((size_t)a->n * sizeof(int) + 1);
+    if (!c.values || !c.col_idx || !c.row_ptr || !next) {
+        free(next);
+        free_crs_d(&c);
+        return 0;
+    }
+
+    for (int i = 0; i < a->n; i++) {
+        for (int k = a->row_ptr[i]; k < a->row_ptr[i + 1]; k++) {
+            c.row_ptr[i + 1]++;
+            if (a->col_idx[k] != i) c.row_ptr[a->col_idx[k] + 1]++;
+        }
+    }
+    for (int i = 0; i < a->n; i++)
+		c.row_ptr[i + 1] += c.row_ptr[i];
+
+    //stored part of row i first, then the mirrored entries arrive in increasing row order,
+    //which is increasing column order in row j
+    for (int i = 0; i < a->n; i++) {
+        next[i] = c.row_ptr[i];
+        for (int k = a->row_ptr[i]; k < a->row_ptr[i + 1]; k++) {
+            c.values[next[i]] = a->values[k];
+            c.col_idx[next[i]] = a->col_idx[k];
+            next[i]++;
+        }
+    }
+    double sign = a->skew ? -1.0 : 1.0;
+    for (int i = 0; i < a->n; i++) {
+        for (int k = a->row_ptr[i]; k < a->row_ptr[i + 1]; k++) {
+            int j = a->col_idx[k];
+            if (j == i) continue;
+            c.values[next[j]] = sign * a->values[k];
+            c.col_idx[next[j]] = i;
+            next[j]++;
+        }
+    }
+
+    free(next);
+    *out = c;
+    return 1;
+}
+
 void print_crs_hw(const crs_t *a) {
     printf("CRS 0-based\n");
     printf("nRows = %d\n", a->n_rows);
@@ -785,3 +1904,117 @@ void print_tjds_hw(const tjds_t *a) {
     print_int_array("tjd_ptr", a->tjd_ptr, a->num_tjd + 1);
 }
 
+
+/* ---- traffic model ---- */
+
+#define T_I4 ((long long)sizeof(int))
+#define T_D8 ((long long)sizeof(double))
+
+//row formats: x once up to once per stored slot, y written once
+static void row_traffic(spmv_traffic_t *t, int n_rows, int n_cols, long long slots) {
+    t->x_lo = (long long)n_cols * T_D8;
+    t->x_hi = slots * T_D8;
+    t->y_lo = (long long)n_rows * T_D8;
+    t->y_hi = t->y_lo;
+}
+
+//formats that add into y[row] once per entry: y zeroed, then a read and a write per entry
+static void scatter_traffic(spmv_traffic_t *t, int n_rows, int n_cols, long long entries) {
+    t->x_lo = (long long)n_cols * T_D8;
+    t->x_hi = entries * T_D8;
+    t->y_lo = (long long)n_rows * T_D8;
+    t->y_hi = (long long)n_rows * T_D8 + 2 * entries * T_D8;
+}
+
+void crs_d_traffic(const crs_d_t *a, spmv_traffic_t *t) {
+    t->values = (long long)a->nnz * T_D8;
+    t->index = (long long)a->nnz * T_I4 + (long long)(a->n_rows + 1) * T_I4;
+    row_traffic(t, a->n_rows, a->n_cols, a->nnz);
+}
+
+void crs_f_traffic(const crs_f_t *a, spmv_traffic_t *t) {
+    t->values = (long long)a->nnz * (long long)sizeof(float);
+    t->index = (long long)a->nnz * T_I4 + (long long)(a->n_rows + 1) * T_I4;
+    row_traffic(t, a->n_rows, a->n_cols, a->nnz);
+}
+
+void crs_delta_traffic(const crs_delta_d_t *a, spmv_traffic_t *t) {
+    t->values = (long long)(a->nnz + a->n_esc) * T_D8;
+    t->index = (long long)a->nnz * (long long)sizeof(uint16_t) + (long long)a->n_seg * T_I4 +
+               (long long)a->n_esc * 2 * T_I4 + (long long)(a->n_rows + 1) * T_I4;
+    row_traffic(t, a->n_rows, a->n_cols, a->nnz + a->n_esc);
+}
+
+//each stored off-diagonal entry is used twice, x_j for row i and x_i into y_j
+void crs_sym_traffic(const crs_sym_d_t *a, spmv_traffic_t *t) {
+    t->values = (long long)a->nnz * T_D8;
+    t->index = (long long)a->nnz * T_I4 + (long long)(a->n + 1) * T_I4;
+    scatter_traffic(t, a->n, a->n, a->nnz);
+}
+
+//ccs reads each x once, only y is scattered
+void ccs_d_traffic(const ccs_d_t *a, spmv_traffic_t *t) {
+    t->values = (long long)a->nnz * T_D8;
+    t->index = (long long)a->nnz * T_I4 + (long long)(a->n_cols + 1) * T_I4;
+    scatter_traffic(t, a->n_rows, a->n_cols, a->nnz);
+    t->x_hi = t->x_lo;
+}
+
+//work[] is packed, so y is touched once through perm; the per diagonal updates hit work
+void jds_d_traffic(const jds_d_t *a, spmv_traffic_t *t) {
+    t->values = (long long)a->nnz * T_D8;
+    t->index = (long long)a->nnz * T_I4 + (long long)a->n_rows * T_I4 + (long long)(a->num_jd + 1) * T_I4;
+    scatter_traffic(t, a->n_rows, a->n_cols, a->nnz);
+    t->y_hi += (long long)a->n_rows * T_D8;
+}
+
+void tjds_d_traffic(const tjds_d_t *a, spmv_traffic_t *t) {
+    t->values = (long long)a->nnz * T_D8;
+    t->index = (long long)a->nnz * T_I4 + (long long)a->n_cols * T_I4 + (long long)(a->num_tjd + 1) * T_I4;
+    scatter_traffic(t, a->n_rows, a->n_cols, a->nnz);
+}
+
+void tjds_f_traffic(const tjds_f_t *a, spmv_traffic_t *t) {
+    t->values = (long long)a->nnz * (long long)sizeof(float);
+    t->index = (long long)a->nnz * T_I4 + (long long)a->n_cols * T_I4 + (long long)(a->num_tjd + 1) * T_I4;
+    scatter_traffic(t, a->n_rows, a->n_cols, a->nnz);
+}
+
+//padding slots are streamed and gathered like real ones
+void sell_d_traffic(const sell_d_t *a, spmv_traffic_t *t) {
+    long long slots = a->chunk_ptr[a->n_chunks];
+    t->values = slots * T_D8;
+    t->index = slots * T_I4 + (long long)a->n_chunks * 2 * T_I4 + (long long)a->n_chunks * a->C * T_I4;
+    row_traffic(t, a->n_rows, a->n_cols, slots);
+}
+
+//column major, so y is swept once per slot column
+void ell_d_traffic(const ell_d_t *a, spmv_traffic_t *t) {
+    long long slots = (long long)a->n_rows * a->width;
+    t->values = slots * T_D8;
+    t->index = slots * T_I4;
+    scatter_traffic(t, a->n_rows, a->n_cols, slots);
+}
+
+void hyb_d_traffic(const hyb_d_t *a, spmv_traffic_t *t) {
+    ell_d_traffic(&a->ell, t);
+    t->values += (long long)a->coo_nnz * T_D8;
+    t->index += (long long)a->coo_nnz * 2 * T_I4;
+    t->x_hi += (long long)a->coo_nnz * T_D8;
+    t->y_hi += (long long)a->coo_nnz * 2 * T_D8;
+}
+
+//one x gather per block column
+void bcsr_d_traffic(const bcsr_d_t *a, spmv_traffic_t *t) {
+    t->values = (long long)a->nnzb * a->r * a->c * T_D8;
+    t->index = (long long)a->nnzb * T_I4 + (long long)(a->n_brows + 1) * T_I4;
+    row_traffic(t, a->n_rows, a->n_cols, (long long)a->nnzb * a->c);
+}
+
+long long traffic_lo(const spmv_traffic_t *t) {
+    return t->values + t->index + t->x_lo + t->y_lo;
+}
+
+long long traffic_hi(const spmv_traffic_t *t) {
+    return t->values + t->index + t->x_hi + t->y_hi;
+}
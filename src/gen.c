@@ -0,0 +1,511 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+
+#include "gen.h"
+#include "formats.h"
+
+//splitmix64, tiny and good enough for test matrices
+static unsigned long long rng_next(unsigned long long *s) {
+    unsigned long long z = (*s += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static int rng_int(unsigned long long *s, int n) {
+    return (int)(rng_next(s) % (unsigned long long)n);
+}
+
+static double rng_unit(unsigned long long *s) {
+    return (double)(rng_next(s) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static int cmp_int_asc(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+//len distinct sorted columns out of [0, width). dense rows walk the range once (knuth's
+//selection sampling), sparse ones draw, sort and redraw whatever came out twice
+static void sample_sorted(unsigned long long *s, int width, int len, int *dst) {
+    if (2LL * len > width) {
+        int m = 0;
+        for (int j = 0; j < width && m < len; j++)
+            if ((long long)rng_int(s, width - j) < len - m) dst[m++] = j;
+        return;
+    }
+
+    int m = 0;
+    while (m < len) {
+        for (int k = m; k < len; k++)
+			dst[k] = rng_int(s, width);
+        qsort(dst, (size_t)len, sizeof(int), cmp_int_asc);
+        m = 1;
+        for (int k = 1; k < len; k++)
+            if (dst[k] != dst[m - 1]) dst[m++] = dst[k];
+    }
+}
+
+int gen_powerlaw_crs(int n_rows, int n_cols, long long nnz, double alpha, unsigned long long seed, crs_d_t *out) {
+    if (n_rows <= 0 || n_cols <= 0) return 0;
+
+    unsigned long long s = seed;
+    int *len = (int *)malloc((size_t)n_rows * sizeof(int));
+    if (!len) return 0;
+
+    double wsum = 0.0;
+    for (int r = 0; r < n_rows; r++)
+		wsum += pow((double)(r + 1), -alpha);
+
+    long long total = 0;
+    for (int r = 0; r < n_rows; r++) {
+        long long l = llround((double)nnz * pow((double)(r + 1), -alpha) / wsum);
+        if (l < 1) l = 1;
+        if (l > n_cols) l = n_cols;
+        len[r] = (int)l;
+        total += l;
+    }
+    if (total > 0x7fffffffLL) { free(len); return 0; }
+
+    //spread the long rows over the matrix instead of stacking them at the top
+    for (int r = n_rows - 1; r > 0; r--) {
+        int q = rng_int(&s, r + 1);
+        int tmp = len[r]; len[r] = len[q]; len[q] = tmp;
+    }
+
+    crs_d_t a;
+    a.n_rows = n_rows;
+    a.n_cols = n_cols;
+    a.nnz = (int)total;
+    a.values = (double *)malloc((size_t)total * sizeof(double));
+    a.col_idx = (int *)malloc((size_t)total * sizeof(int));
+    a.row_ptr = (int *)malloc(((size_t)n_rows + 1) * sizeof(int));
+    if (!a.values || !a.col_idx || !a.row_ptr) {
+        free(len);
+        free_crs_d(&a);
+        return 0;
+    }
+
+    a.row_ptr[0] = 0;
+    for (int r = 0; r < n_rows; r++) {
+        int base = a.row_ptr[r];
+        sample_sorted(&s, n_cols, len[r], a.col_idx + base);
+        for (int k = 0; k < len[r]; k++)
+			a.values[base + k] = 2.0 * rng_unit(&s) - 1.0;
+        a.row_ptr[r + 1] = base + len[r];
+    }
+
+    free(len);
+    *out = a;
+    return 1;
+}
+
+int gen_banded_crs(int n, int half_bw, int per_row, unsigned long long seed, crs_d_t *out) {
+    if (n <= 0 || half_bw < 0 || per_row <= 0) return 0;
+    if (per_row > 2 * half_bw + 1) per_row = 2 * half_bw + 1;
+
+    long long total = 0;
+    for (int r = 0; r < n; r++) {
+        int lo = r - half_bw < 0 ? 0 : r - half_bw;
+        int hi = r + half_bw >= n ? n - 1 : r + half_bw;
+        total += (hi - lo + 1) < per_row ? (hi - lo + 1) : per_row;
+    }
+    if (total > 0x7fffffffLL) return 0;
+
+    unsigned long long s = seed;
+    crs_d_t a;
+    a.n_rows = n;
+    a.n_cols = n;
+    a.nnz = (int)total;
+    a.values = (double *)malloc((size_t)total * sizeof(double));
+    a.col_idx = (int *)malloc((size_t)total * sizeof(int));
+    a.row_ptr = (int *)malloc(((size_t)n + 1) * sizeof(int));
+    if (!a.values || !a.col_idx || !a.row_ptr) {
+        free_crs_d(&a);
+        return 0;
+    }
+
+    a.row_ptr[0] = 0;
+    for (int r = 0; r < n; r++) {
+        int lo = r - half_bw < 0 ? 0 : r - half_bw;
+        int hi = r + half_bw >= n ? n - 1 : r + half_bw;
+        int width = hi - lo + 1;
+        int len = width < per_row ? width : per_row;
+        int base = a.row_ptr[r];
+
+        //Floyd's sampling, len distinct picks out of width
+        int m = 0;
+        for (int j = width - len; j < width; j++) {
+            int t = rng_int(&s, j + 1);
+            int dup = 0;
+            for (int q = 0; q < m; q++)
+                if (a.col_idx[base + q] == lo + t) { dup = 1; break; }
+            a.col_idx[base + m++] = dup ? lo + j : lo + t;
+        }
+        qsort(a.col_idx + base, (size_t)len, sizeof(int), cmp_int_asc);
+        for (int k = 0; k < len; k++)
+			a.values[base + k] = 2.0 * rng_unit(&s) - 1.0;
+        a.row_ptr[r + 1] = base + len;
+    }
+
+    *out = a;
+    return 1;
+}
+
+void gen_random_perm(int n, unsigned long long seed, int *perm) {
+    unsigned long long s = seed;
+    for (int i = 0; i < n; i++) perm[i] = i;
+    for (int i = n - 1; i > 0; i--) {
+        int q = rng_int(&s, i + 1);
+        int tmp = perm[i]; perm[i] = perm[q]; perm[q] = tmp;
+    }
+}
+
+/* ---- row parallel generators ---- */
+
+//independent stream per row / edge: the start state is hashed, so neighbouring indices don't
+//walk the same splitmix sequence. output is the same for any thread count
+static unsigned long long rng_stream(unsigned long long seed, unsigned long long idx) {
+    unsigned long long s = seed ^ (idx * 0xD1B54A32D192ED03ULL);
+    return rng_next(&s);
+}
+
+static int alloc_crs(int n_rows, int n_cols, long long nnz, crs_d_t *a) {
+    a->n_rows = n_rows;
+    a->n_cols = n_cols;
+    a->nnz = (int)nnz;
+    a->values = (double *)malloc((size_t)nnz * sizeof(double) + 1);
+    a->col_idx = (int *)malloc((size_t)nnz * sizeof(int) + 1);
+    a->row_ptr = (int *)malloc(((size_t)n_rows + 1) * sizeof(int));
+    if (!a->values || !a->col_idx || !a->row_ptr) {
+        free_crs_d(a);
+        return 0;
+    }
+    return 1;
+}
+
+//row_ptr from per row lengths in row_ptr[1..n], 0 if the total doesn't fit an int
+static int lengths_to_ptr(int *row_ptr, int n, long long *total) {
+    long long t = 0;
+    row_ptr[0] = 0;
+    for (int r = 0; r < n; r++) {
+        t += row_ptr[r + 1];
+        if (t > 0x7fffffffLL) return 0;
+        row_ptr[r + 1] = (int)t;
+    }
+    *total = t;
+    return 1;
+}
+
+static void fill_values(crs_d_t *a, unsigned long long seed) {
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (int r = 0; r < a->n_rows; r++) {
+        unsigned long long s = rng_stream(seed, (unsigned long long)r);
+        for (int k = a->row_ptr[r]; k < a->row_ptr[r + 1]; k++)
+			a->values[k] = 2.0 * rng_unit(&s) - 1.0;
+    }
+}
+
+int gen_uniform_crs(int n_rows, int n_cols, long long nnz, unsigned long long seed, crs_d_t *out) {
+    if (n_rows <= 0 || n_cols <= 0 || nnz < 0) return 0;
+    if (nnz > (long long)n_rows * n_cols) nnz = (long long)n_rows * n_cols;
+    if (nnz > 0x7fffffffLL) return 0;
+
+    crs_d_t a;
+    if (!alloc_crs(n_rows, n_cols, nnz, &a)) return 0;
+    long long base = nnz / n_rows, extra = nnz % n_rows;
+    for (int r = 0; r < n_rows; r++)
+		a.row_ptr[r + 1] = (int)(base + (r < extra));
+    lengths_to_ptr(a.row_ptr, n_rows, &nnz);
+
+    #pragma omp parallel for schedule(dynamic, 256)
+    for (int r = 0; r < n_rows; r++) {
+        unsigned long long s = rng_stream(seed, (unsigned long long)r);
+        sample_sorted(&s, n_cols, a.row_ptr[r + 1] - a.row_ptr[r], a.col_idx + a.row_ptr[r]);
+    }
+    fill_values(&a, ~seed);
+
+    *out = a;
+    return 1;
+}
+
+//5 point laplacian on nx x ny, row i + nx * j, columns ascending: south, west, center, east, north
+int gen_poisson2d_crs(int nx, int ny, crs_d_t *out) {
+    if (nx <= 0 || ny <= 0 || (long long)nx * ny > 0x7fffffffLL) return 0;
+    int n = nx * ny;
+    long long nnz = 5LL * n - 2LL * nx - 2LL * ny;
+    if (nnz > 0x7fffffffLL) return 0;
+
+    crs_d_t a;
+    if (!alloc_crs(n, n, nnz, &a)) return 0;
+    for (int r = 0; r < n; r++) {
+        int i = r % nx, j = r / nx;
+        a.row_ptr[r + 1] = 1 + (i > 0) + (i < nx - 1) + (j > 0) + (j < ny - 1);
+    }
+    lengths_to_ptr(a.row_ptr, n, &nnz);
+
+    #pragma omp parallel for schedule(static)
+    for (int r = 0; r < n; r++) {
+        int i = r % nx, j = r / nx;
+        int k = a.row_ptr[r];
+        if (j > 0)      { a.col_idx[k] = r - nx; a.values[k++] = -1.0; }
+        if (i > 0)      { a.col_idx[k] = r - 1;  a.values[k++] = -1.0; }
+        a.col_idx[k] = r; a.values[k++] = 4.0;
+        if (i < nx - 1) { a.col_idx[k] = r + 1;  a.values[k++] = -1.0; }
+        if (j < ny - 1) { a.col_idx[k] = r + nx; a.values[k++] = -1.0; }
+    }
+
+    *out = a;
+    return 1;
+}
+
+//7 point laplacian, row i + nx * (j + ny * l)
+int gen_poisson3d_crs(int nx, int ny, int nz, crs_d_t *out) {
+    if (nx <= 0 || ny <= 0 || nz <= 0 || (long long)nx * ny * nz > 0x7fffffffLL) return 0;
+    int n = nx * ny * nz;
+    int plane = nx * ny;
+    long long nnz = 7LL * n - 2LL * ny * nz - 2LL * nx * nz - 2LL * nx * ny;
+    if (nnz > 0x7fffffffLL) return 0;
+
+    crs_d_t a;
+    if (!alloc_crs(n, n, nnz, &a)) return 0;
+    for (int r = 0; r < n; r++) {
+        int i = r % nx, j = (r / nx) % ny, l = r / plane;
+        a.row_ptr[r + 1] = 1 + (i > 0) + (i < nx - 1) + (j > 0) + (j < ny - 1) + (l > 0) + (l < nz - 1);
+    }
+    lengths_to_ptr(a.row_ptr, n, &nnz);
+
+    #pragma omp parallel for schedule(static)
+    for (int r = 0; r < n; r++) {
+        int i = r % nx, j = (r / nx) % ny, l = r / plane;
+        int k = a.row_ptr[r];
+        if (l > 0)      { a.col_idx[k] = r - plane; a.values[k++] = -1.0; }
+        if (j > 0)      { a.col_idx[k] = r - nx;    a.values[k++] = -1.0; }
+        if (i > 0)      { a.col_idx[k] = r - 1;     a.values[k++] = -1.0; }
+        a.col_idx[k] = r; a.values[k++] = 6.0;
+        if (i < nx - 1) { a.col_idx[k] = r + 1;     a.values[k++] = -1.0; }
+        if (j < ny - 1) { a.col_idx[k] = r + nx;    a.values[k++] = -1.0; }
+        if (l < nz - 1) { a.col_idx[k] = r + plane; a.values[k++] = -1.0; }
+    }
+
+    *out = a;
+    return 1;
+}
+
+//r-mat levels are independent, so the row bits of an edge come first (down with probability
+//c + d each level) and the column bits only depend on the row bit of the same level:
+//right with b / (a + b) under a 0 row bit, d / (c + d) under a 1. the rows get counted over
+//the edges, then every row draws its own columns in place, no scatter. cut points are in
+//1/65536 steps and a draw feeds four levels
+typedef struct { unsigned down, right_up, right_down; } rmat_cut_t;
+
+static unsigned cut16(double p) {
+    if (p <= 0.0) return 0;
+    if (p >= 1.0) return 65536;
+    return (unsigned)(p * 65536.0);
+}
+
+static int rmat_row(unsigned long long seed, long long e, int scale, const rmat_cut_t *q) {
+    unsigned long long s = rng_stream(seed, (unsigned long long)e);
+    unsigned long long bits = 0;
+    int r = 0;
+    for (int lvl = 0; lvl < scale; lvl++) {
+        if ((lvl & 3) == 0) bits = rng_next(&s);
+        r = (r << 1) | ((unsigned)(bits & 0xffff) < q->down);
+        bits >>= 16;
+    }
+    return r;
+}
+
+//compares instead of branches, the bits are random and would mispredict every level
+static int rmat_col(unsigned long long *s, int row, int scale, const rmat_cut_t *q) {
+    unsigned long long bits = 0;
+    int c = 0;
+    for (int lvl = 0; lvl < scale; lvl++) {
+        if ((lvl & 3) == 0) bits = rng_next(s);
+        int rb = (row >> (scale - 1 - lvl)) & 1;
+        unsigned cut = rb ? q->right_down : q->right_up;
+        c = (c << 1) | ((unsigned)(bits & 0xffff) < cut);
+        bits >>= 16;
+    }
+    return c;
+}
+
+//most r-mat rows are a handful of entries, where qsort's call per compare dominates
+static void sort_ints(int *p, int m) {
+    if (m > 32) {
+        qsort(p, (size_t)m, sizeof(int), cmp_int_asc);
+        return;
+    }
+    for (int i = 1; i < m; i++) {
+        int v = p[i], j = i;
+        while (j > 0 && p[j - 1] > v) { p[j] = p[j - 1]; j--; }
+        p[j] = v;
+    }
+}
+
+int gen_rmat_crs(int scale, int edge_factor, double pa, double pb, double pc, unsigned long long seed,
+                 crs_d_t *out) {
+    if (scale < 1 || scale > 30 || edge_factor <= 0 || pa < 0 || pb < 0 || pc < 0 || pa + pb + pc > 1.0)
+        return 0;
+    int n = 1 << scale;
+    long long edges = (long long)edge_factor * n;
+    if (edges > 0x7fffffffLL) return 0;
+
+    double pd = 1.0 - pa - pb - pc;
+    rmat_cut_t q;
+    q.down = cut16(pc + pd);
+    q.right_up = cut16(pa + pb > 0.0 ? pb / (pa + pb) : 0.0);
+    q.right_down = cut16(pc + pd > 0.0 ? pd / (pc + pd) : 0.0);
+
+    int *cnt = (int *)calloc((size_t)n + 1, sizeof(int));
+    int *len = (int *)malloc(((size_t)n + 1) * sizeof(int));
+    int *cols = (int *)malloc((size_t)edges * sizeof(int) + 1);
+    if (!cnt || !len || !cols) { free(cnt); free(len); free(cols); return 0; }
+
+    #pragma omp parallel for schedule(static)
+    for (long long e = 0; e < edges; e++) {
+        int r = rmat_row(seed, e, scale, &q);
+        #pragma omp atomic
+        cnt[r + 1]++;
+    }
+    long long total = 0;
+    lengths_to_ptr(cnt, n, &total);
+
+    //repeated edges collapse to one entry, len gets the new row lengths
+    #pragma omp parallel for schedule(dynamic, 256)
+    for (int r = 0; r < n; r++) {
+        unsigned long long s = rng_stream(~seed, (unsigned long long)r);
+        int *p = cols + cnt[r];
+        int m = cnt[r + 1] - cnt[r];
+        for (int k = 0; k < m; k++)
+			p[k] = rmat_col(&s, r, scale, &q);
+        sort_ints(p, m);
+        int u = m > 0;
+        for (int k = 1; k < m; k++)
+            if (p[k] != p[u - 1]) p[u++] = p[k];
+        len[r + 1] = u;
+    }
+    lengths_to_ptr(len, n, &total);
+
+    crs_d_t a;
+    if (!alloc_crs(n, n, total, &a)) { free(cnt); free(cols); free(len); return 0; }
+    memcpy(a.row_ptr, len, ((size_t)n + 1) * sizeof(int));
+    #pragma omp parallel for schedule(static)
+    for (int r = 0; r < n; r++)
+		memcpy(a.col_idx + a.row_ptr[r], cols + cnt[r], (size_t)(a.row_ptr[r + 1] - a.row_ptr[r]) * sizeof(int));
+    fill_values(&a, seed);
+
+    free(cnt);
+    free(cols);
+    free(len);
+    *out = a;
+    return 1;
+}
+
+int gen_blockdiag_crs(int n, int b, unsigned long long seed, crs_d_t *out) {
+    if (n <= 0 || b <= 0) return 0;
+    if (b > n) b = n;
+    long long nnz = 0;
+    for (int start = 0; start < n; start += b) {
+        long long w = (n - start < b) ? n - start : b;
+        nnz += w * w;
+    }
+    if (nnz > 0x7fffffffLL) return 0;
+
+    crs_d_t a;
+    if (!alloc_crs(n, n, nnz, &a)) return 0;
+    for (int r = 0; r < n; r++) {
+        int start = r / b * b;
+        a.row_ptr[r + 1] = (n - start < b) ? n - start : b;
+    }
+    lengths_to_ptr(a.row_ptr, n, &nnz);
+
+    #pragma omp parallel for schedule(static)
+    for (int r = 0; r < n; r++) {
+        int start = r / b * b;
+        for (int k = a.row_ptr[r]; k < a.row_ptr[r + 1]; k++)
+			a.col_idx[k] = start + (k - a.row_ptr[r]);
+    }
+    fill_values(&a, seed);
+
+    *out = a;
+    return 1;
+}
+
+/* ---- specs ---- */
+
+//up to max numbers after the name, separated by ':'; returns how many, -1 on junk
+static int spec_numbers(const char *p, double *v, int max) {
+    int k = 0;
+    while (*p == ':') {
+        char *end;
+        if (k == max) return -1;
+        v[k++] = strtod(p + 1, &end);
+        if (end == p + 1) return -1;
+        p = end;
+    }
+    return *p == '\0' ? k : -1;
+}
+
+//the first n spec numbers become int arguments, a double past INT_MAX is undefined to convert
+static int ints_fit(const double *v, int n) {
+    for (int i = 0; i < n; i++)
+		if (v[i] > (double)INT_MAX) return 0;
+    return 1;
+}
+
+int gen_from_spec(const char *spec, crs_d_t *out) {
+    static const char *names[] = { "banded", "poisson2d", "poisson3d", "uniform", "powerlaw", "rmat", "blockdiag" };
+    int which = -1;
+    size_t nl = 0;
+    for (int i = 0; i < (int)(sizeof(names) / sizeof(names[0])); i++) {
+        size_t l = strlen(names[i]);
+        if (strncmp(spec, names[i], l) == 0 && (spec[l] == ':' || spec[l] == '\0')) {
+            which = i;
+            nl = l;
+        }
+    }
+    if (which < 0) return 0;
+
+    double v[6];
+    int k = spec_numbers(spec + nl, v, 6);
+    if (k < 1) return 0;
+    for (int i = 0; i < k; i++)
+        if (v[i] < 0 || v[i] > 9e18) return 0;
+    unsigned long long seed = 42;
+
+    switch (which) {
+    case 0:     //banded:n:half_bw:per_row[:seed]
+        if (k < 3 || k > 4 || !ints_fit(v, 3)) return 0;
+        if (k == 4) seed = (unsigned long long)v[3];
+        return gen_banded_crs((int)v[0], (int)v[1], (int)v[2], seed, out);
+    case 1:     //poisson2d:nx[:ny]
+        if (k > 2 || !ints_fit(v, k)) return 0;
+        return gen_poisson2d_crs((int)v[0], (int)v[k - 1], out);
+    case 2:     //poisson3d:nx[:ny:nz]
+        if ((k != 1 && k != 3) || !ints_fit(v, k)) return 0;
+        return gen_poisson3d_crs((int)v[0], (int)v[k == 3 ? 1 : 0], (int)v[k - 1], out);
+    case 3:     //uniform:n:nnz_per_row[:seed]
+        if (k < 2 || k > 3 || !ints_fit(v, 1) || v[0] * v[1] > 9e18) return 0;
+        if (k == 3) seed = (unsigned long long)v[2];
+        return gen_uniform_crs((int)v[0], (int)v[0], llround(v[0] * v[1]), seed, out);
+    case 4:     //powerlaw:n:nnz_per_row:alpha[:seed]
+        if (k < 3 || k > 4 || !ints_fit(v, 1) || v[0] * v[1] > 9e18) return 0;
+        if (k == 4) seed = (unsigned long long)v[3];
+        return gen_powerlaw_crs((int)v[0], (int)v[0], llround(v[0] * v[1]), v[2], seed, out);
+    case 5:     //rmat:scale:edge_factor[:seed], graph500 probabilities
+        if (k < 2 || k > 3 || !ints_fit(v, 2)) return 0;
+        if (k == 3) seed = (unsigned long long)v[2];
+        return gen_rmat_crs((int)v[0], (int)v[1], 0.57, 0.19, 0.19, seed, out);
+    case 6:     //blockdiag:n:b[:seed]
+        if (k < 2 || k > 3 || !ints_fit(v, 2)) return 0;
+        if (k == 3) seed = (unsigned long long)v[2];
+        return gen_blockdiag_crs((int)v[0], (int)v[1], seed, out);
+    }
+    return 0;
+}
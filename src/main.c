@@ -1,15 +1,83 @@
 #define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
 #include "matrix_multiply_io.h"
+#include "sparse_bin.h"
 #include "formats.h"
 #include "spmv.h"
 #include "bench.h"
 #include "util.h"
+#include "gen.h"
+#include "reorder.h"
+#include "variant.h"
+#include "driver.h"
 
 void demo_q1(void);
-void run_ibm32_dense(const char *path);
-void run_memplus_sparse(const char *path);
+void run_ibm32_sparse(const char *mtx_path);
+void run_memplus_sparse(const char *mtx_path, const char *bin_path);
+void run_stream_build(const char *mtx_path);
+void run_mmap_check(const char *int_path, const char *double_path);
+void run_build_bench(const char *mtx_path);
+void run_merge_bench(const char *mtx_path);
+void run_delta_bench(void);
+void run_sym_bench(const char *mtx_path);
+void run_rcm_bench(const char *mtx_path);
+
+//checksum of another kernel's y against the crs reference y, tol relative to the checksum
+static void verify_double_tol(const char *name, const double *y_ref, const double *y, int n, double tol) {
+    double s_ref = checksum_vec_double(y_ref, n);
+    double s = checksum_vec_double(y, n);
+    double diff = s_ref - s;
+    if (diff < 0)
+		diff = -diff;
+    double scale = s_ref < 0 ? -s_ref : s_ref;
+    printf("  checksum %-5s = %.12g %s\n", name, s,
+           (diff > tol * (scale > 1.0 ? scale : 1.0)) ? "bruh: mismatch" : "ok");
+}
+
+static void verify_double(const char *name, const double *y_ref, const double *y, int n) {
+    verify_double_tol(name, y_ref, y, n, 1e-8);
+}
+
+//profile the kernels on a dense matrix, estimate every block shape on 1/8 of the block rows,
+//then build and time all of them so the pick can be checked against what actually ran fastest
+static void run_bcsr(const crs_d_t *crs, const double *x, const double *y_ref, double *y) {
+    double prof[4][4], fill[4][4];
+    int r, c;
+    bench_bcsr_profile(512, prof);
+    bcsr_choose_block(crs, 8, prof, &r, &c, fill);
+
+    printf("bcsr dense mflops / estimated fill (rows r = 1..4, cols c = 1..4), pick %dx%d\n", r, c);
+    for (int i = 0; i < 4; i++)
+		printf("  %5.0f/%.3f %5.0f/%.3f %5.0f/%.3f %5.0f/%.3f\n", prof[i][0], fill[i][0], prof[i][1], fill[i][1],
+               prof[i][2], fill[i][2], prof[i][3], fill[i][3]);
+
+    for (int rr = 1; rr <= 4; rr++) {
+        for (int cc = 1; cc <= 4; cc++) {
+            bcsr_d_t b;
+            if (!build_bcsr_from_crs_double(crs, rr, cc, &b)) continue;
+            bench_bcsr_double(crs, &b, x, y, 1000);
+
+            bcsr_spmv_double(&b, x, y);
+            verify_double(rr == r && cc == c ? "bcsr*" : "bcsr", y_ref, y, crs->n_rows);
+            free_bcsr_d(&b);
+        }
+    }
+}
+
+//mapped structs belong to the sbin mapping, built ones to us
+static void release_memplus(int mapped, sbin_map_t *bin, crs_d_t *crs, ccs_d_t *ccs, tjds_d_t *tjds) {
+    if (mapped) {
+        sbin_unmap(bin);
+        return;
+    }
+    free_tjds_d(tjds);
+    free_ccs_d(ccs);
+    free_crs_d(crs);
+}
 
 void demo_q1(void) {
     int a6[6][6] = {
@@ -77,11 +145,20 @@ void demo_q1(void) {
     free_tjds(&tjds);
 }
 
-void run_ibm32_dense(const char *mtx_path) {
-    int *a = NULL;
+//dense copy is only built as a reference for small matrices
+#define DENSE_REF_MAX_CELLS (4096LL * 4096LL)
+
+static int same_vec(const int *a, const int *b, int n) {
+    for (int i = 0; i < n; i++)
+		if (a[i] != b[i]) return 0;
+    return 1;
+}
+
+void run_ibm32_sparse(const char *mtx_path) {
+    triplet_t *t = NULL;
     int n_rows = 0, n_cols = 0, nnz = 0;
 
-    if (!mm_read_dense_int(mtx_path, &a, &n_rows, &n_cols, &nnz)) {
+    if (!mm_read_triplets_int_mmap(mtx_path, &t, &n_rows, &n_cols, &nnz, NULL)) {
         printf("=== Q2/Q3 IBM32 ===\n");
         printf("couldn't open %s (skipping)\n\n", mtx_path);
         return;
@@ -93,31 +170,74 @@ void run_ibm32_dense(const char *mtx_path) {
     printf("nCols = %d\n", n_cols);
     printf("nnz  = %d\n\n", nnz);
 
+    crs_t crs;
+    tjds_t tjds;
+    if (!build_crs_from_triplets(n_rows, n_cols, t, nnz, &crs)) {
+        fprintf(stderr, "failed building crs\n");
+        free(t);
+        return;
+    }
+    if (!build_tjds_from_triplets(n_rows, n_cols, t, nnz, &tjds)) {
+        fprintf(stderr, "failed building tjds\n");
+        free_crs(&crs);
+        free(t);
+        return;
+    }
+    free(t);
+    //the struct returning builder signals failure with a NULL perm, like build_jds_from_triplets checks it
+    jds_t jds = build_jds_from_crs(&crs);
+    if (!jds.perm && n_rows > 0) {
+        fprintf(stderr, "failed building jds\n");
+        free_tjds(&tjds);
+        free_crs(&crs);
+        return;
+    }
+
     int *x = (int *)malloc((size_t)n_cols * sizeof(int));
     int *y = (int *)malloc((size_t)n_rows * sizeof(int));
-    if (!x || !y) {
+    int *y_ref = (int *)malloc((size_t)n_rows * sizeof(int));
+    if (!x || !y || !y_ref) {
         fprintf(stderr, "malloc failed\n");
-        free(a);
         free(x);
         free(y);
+        free(y_ref);
+        free_jds(&jds);
+        free_tjds(&tjds);
+        free_crs(&crs);
         return;
     }
     for (int i = 0; i < n_cols; i++)
 		x[i] = 1;
 
-    bench_dense(a, n_rows, n_cols, x, y, 1000);
-    bench_dense(a, n_rows, n_cols, x, y, 10000);
+    int *a = NULL;
+    int d_rows = 0, d_cols = 0, d_nnz = 0;
+    int have_dense = (long long)n_rows * (long long)n_cols <= DENSE_REF_MAX_CELLS &&
+                     mm_read_dense_int(mtx_path, &a, &d_rows, &d_cols, &d_nnz);
+
+    if (have_dense) {
+        bench_dense(a, n_rows, n_cols, x, y, 1000);
+        bench_dense(a, n_rows, n_cols, x, y, 10000);
+        dense_spmv(a, n_rows, n_cols, x, y_ref);
+    } else {
+        crs_spmv(&crs, x, y_ref);
+    }
 
-    crs_t crs = build_crs_from_dense(a, n_rows, n_cols);
     bench_crs(&crs, x, y, 1000);
     bench_crs(&crs, x, y, 10000);
 
-    tjds_t tjds = build_tjds_from_dense(a, n_rows, n_cols);
     bench_tjds(&tjds, x, y, 1000);
     bench_tjds(&tjds, x, y, 10000);
 
+    printf("\nverify vs %s:", have_dense ? "dense" : "crs");
+    crs_spmv(&crs, x, y);
+    int ok = same_vec(y, y_ref, n_rows);
+    jds_spmv(&jds, x, y);
+    ok = ok && same_vec(y, y_ref, n_rows);
     tjds_spmv(&tjds, x, y);
-    printf("\nquick y peek: y[0]=%d", y[0]);
+    ok = ok && same_vec(y, y_ref, n_rows);
+    printf(" %s\n", ok ? "ok: crs/jds/tjds match" : "bruh: mismatch");
+
+    printf("quick y peek: y[0]=%d", y[0]);
     if (n_rows > 1)
 		printf(" y[1]=%d", y[1]);
     if (n_rows > 2)
@@ -125,55 +245,96 @@ void run_ibm32_dense(const char *mtx_path) {
     printf("\n\n");
 
     free_crs(&crs);
+    free_jds(&jds);
     free_tjds(&tjds);
     free(a);
     free(x);
     free(y);
+    free(y_ref);
 }
 
-void run_memplus_sparse(const char *mtx_path) {
-    triplet_d_t *t = NULL;
+void run_memplus_sparse(const char *mtx_path, const char *bin_path) {
+    crs_d_t crs;
+    ccs_d_t ccs;
+    tjds_d_t tjds;
+    sbin_map_t bin;
+    int mapped = 0;
     int n_rows = 0, n_cols = 0, nnz = 0;
 
-    if (!mm_read_triplets_double(mtx_path, &t, &n_rows, &n_cols, &nnz)) {
-        printf("=== Q4 MEMPLUS ===\n");
-        printf("couldn't open %s (skipping)\n\n", mtx_path);
-        return;
+    long long t0 = now_ns();
+    if (bin_path && sbin_map(bin_path, mtx_path, &bin)) {
+        if (bin.flags == (SBIN_HAS_CRS | SBIN_HAS_CCS | SBIN_HAS_TJDS)) {
+            crs = bin.crs;
+            ccs = bin.ccs;
+            tjds = bin.tjds;
+            mapped = 1;
+        } else {
+            sbin_unmap(&bin);
+        }
     }
 
-    printf("=== Q4 MEMPLUS loaded (double) ===\n");
-    printf("file = %s\n", mtx_path);
-    printf("nRows = %d\n", n_rows);
-    printf("nCols = %d\n", n_cols);
-    printf("nnz  = %d\n\n", nnz);
+    if (mapped) {
+        long long t1 = now_ns();
+        n_rows = crs.n_rows;
+        n_cols = crs.n_cols;
+        nnz = crs.nnz;
 
-    crs_d_t crs;
-    if (!build_crs_from_triplets_double(n_rows, n_cols, t, nnz, &crs)) {
-        fprintf(stderr, "failed building crs(double)\n");
-        free(t);
-        return;
-    }
+        printf("=== Q4 MEMPLUS mapped (double) ===\n");
+        printf("file = %s (from %s)\n", bin_path, mtx_path);
+        printf("nRows = %d\n", n_rows);
+        printf("nCols = %d\n", n_cols);
+        printf("nnz  = %d\n", nnz);
+        printf("startup = open+map %.3f ms\n\n", (double)(t1 - t0) / 1e6);
+    } else {
+        triplet_d_t *t = NULL;
+        mm_stats_t load;
 
-    ccs_d_t ccs;
-    if (!build_ccs_from_triplets_double(n_rows, n_cols, t, nnz, &ccs)) {
-        fprintf(stderr, "failed building ccs(double)\n");
-        free_crs_d(&crs);
+        if (!mm_read_triplets_double_mmap(mtx_path, &t, &n_rows, &n_cols, &nnz, &load)) {
+            printf("=== Q4 MEMPLUS ===\n");
+            printf("couldn't open %s (skipping)\n\n", mtx_path);
+            return;
+        }
+
+        printf("=== Q4 MEMPLUS loaded (double) ===\n");
+        printf("file = %s\n", mtx_path);
+        printf("nRows = %d\n", n_rows);
+        printf("nCols = %d\n", n_cols);
+        printf("nnz  = %d\n", nnz);
+        printf("load = %.3f MB in %.3f ms (%.1f MB/s, %d threads)\n",
+               (double)load.bytes / 1e6, (double)load.time_ns / 1e6,
+               (double)load.bytes / 1e6 / ((double)load.time_ns / 1e9), load.threads);
+
+        if (!build_crs_from_triplets_double_par(n_rows, n_cols, t, nnz, 0, &crs)) {
+            fprintf(stderr, "failed building crs(double)\n");
+            free(t);
+            return;
+        }
+
+        if (!build_ccs_from_triplets_double_par(n_rows, n_cols, t, nnz, 0, &ccs)) {
+            fprintf(stderr, "failed building ccs(double)\n");
+            free_crs_d(&crs);
+            free(t);
+            return;
+        }
         free(t);
-        return;
-    }
 
-    tjds_d_t tjds = build_tjds_from_ccs_double(&ccs);
+        tjds = build_tjds_from_ccs_double(&ccs);
+
+        long long t1 = now_ns();
+        printf("startup = parse+convert %.3f ms\n", (double)(t1 - t0) / 1e6);
+        if (bin_path && tjds.tjd && sbin_write(bin_path, &crs, &ccs, &tjds, mtx_path))
+			printf("wrote %s, next run maps it\n", bin_path);
+        printf("\n");
+    }
 
     double *x = (double *)malloc((size_t)n_cols * sizeof(double));
     double *y_crs = (double *)malloc((size_t)n_rows * sizeof(double));
     double *y_tjds = (double *)malloc((size_t)n_rows * sizeof(double));
-    if (!x || !y_crs || !y_tjds) {
+    double *y_par = (double *)malloc((size_t)n_rows * sizeof(double));
+    if (!x || !y_crs || !y_tjds || !y_par) {
         fprintf(stderr, "malloc failed\n");
-        free(x); free(y_crs); free(y_tjds);
-        free_tjds_d(&tjds);
-        free_ccs_d(&ccs);
-        free_crs_d(&crs);
-        free(t);
+        free(x); free(y_crs); free(y_tjds); free(y_par);
+        release_memplus(mapped, &bin, &crs, &ccs, &tjds);
         return;
     }
 
@@ -186,6 +347,65 @@ void run_memplus_sparse(const char *mtx_path) {
     bench_tjds_double(&tjds, x, y_tjds, 1000);
     bench_tjds_double(&tjds, x, y_tjds, 10000);
 
+    crs_part_t part;
+    int have_part = crs_partition_nnz(&crs, get_num_threads(), &part);
+    if (have_part) {
+        bench_crs_double_par(&crs, &part, x, y_par, 1000);
+        bench_crs_double_par(&crs, &part, x, y_par, 10000);
+    }
+
+    jds_d_t jds;
+    crs_part_t jds_part;
+    int have_jds = build_jds_from_crs_double(&crs, &jds);
+    if (have_jds && !jds_partition_nnz(&jds, get_num_threads(), &jds_part)) {
+        free_jds_d(&jds);
+        have_jds = 0;
+    }
+    if (have_jds)
+		bench_jds_double(&jds, &jds_part, x, y_par, 1000);
+
+    //plain ELL pads every row to the longest one, only worth it when that stays small
+    ell_d_t ell;
+    int have_ell = build_ell_from_crs_double(&crs, &ell);
+    if (have_ell)
+		bench_ell_double(&ell, x, y_par, 1000);
+    else
+		printf("ell skipped, padding to the longest row would be > %dx nnz\n", ELL_MAX_PAD);
+
+    hyb_d_t hyb;
+    int have_hyb = build_hyb_from_crs_double(&crs, -1, &hyb);
+    if (have_hyb)
+		bench_hyb_double(&hyb, x, y_par, 1000);
+
+    //auto mode plus both forced modes so each path gets exercised
+    scatter_plan_t tjds_plan[3], ccs_plan[3];
+    int have_tjds_plan[3], have_ccs_plan[3];
+    for (int m = 0; m < 3; m++) {
+        have_tjds_plan[m] = tjds_par_plan(&tjds, get_num_threads(), m, &tjds_plan[m]);
+        have_ccs_plan[m] = ccs_par_plan(&ccs, get_num_threads(), m, &ccs_plan[m]);
+        if (have_tjds_plan[m])
+			bench_tjds_double_par(&tjds, &tjds_plan[m], x, y_par, 1000);
+        if (have_ccs_plan[m])
+			bench_ccs_double_par(&ccs, &ccs_plan[m], x, y_par, 1000);
+    }
+
+    bench_simd_double(&crs, &tjds, x, 1000);
+    bench_mixed_double(&crs, &tjds, x, 1000);
+
+    int spmm_k[6] = { 1, 4, 8, 16, 32, 6 };
+    bench_spmm_double(&crs, &tjds, spmm_k, 6, 50);
+    bench_transpose_double(&crs, &ccs, x, 1000);
+
+    //no sorting, a local window, and one global sort (plain sliced ELLPACK on sorted rows)
+    int sigmas[3] = { 1, 32 * sell_simd_C(), n_rows };
+    sell_d_t sell[3];
+    int have_sell[3];
+    for (int q = 0; q < 3; q++) {
+        have_sell[q] = build_sell_from_crs_double(&crs, sell_simd_C(), sigmas[q], &sell[q]);
+        if (have_sell[q])
+			bench_sell_double(&sell[q], x, y_par, 1000);
+    }
+
     /* verify */
     crs_spmv_double(&crs, x, y_crs);
     tjds_spmv_double(&tjds, x, y_tjds);
@@ -209,24 +429,616 @@ void run_memplus_sparse(const char *mtx_path) {
 		printf("  bruh: checksum mismatch (tjds bug)\n");
     else
 		printf("  ok: checksums match\n");
+
+    if (have_part) {
+        crs_spmv_double_par(&crs, &part, x, y_par);
+        verify_double("crs_par", y_crs, y_par, n_rows);
+        free_crs_part(&part);
+    }
+    //y_tjds is checked already, it is the jds workspace from here on
+    if (have_jds) {
+        jds_spmv_double(&jds, x, y_par, y_tjds);
+        verify_double("jds", y_crs, y_par, n_rows);
+        jds_spmv_double(&jds, x, y_par, NULL);
+        verify_double("jds_perm", y_crs, y_par, n_rows);
+        jds_spmv_double_par(&jds, &jds_part, x, y_par, y_tjds);
+        verify_double("jds_par", y_crs, y_par, n_rows);
+        free_crs_part(&jds_part);
+        free_jds_d(&jds);
+    }
+    if (have_ell) {
+        ell_spmv_double(&ell, x, y_par);
+        verify_double("ell", y_crs, y_par, n_rows);
+        free_ell_d(&ell);
+    }
+    if (have_hyb) {
+        hyb_spmv_double(&hyb, x, y_par);
+        verify_double("hyb", y_crs, y_par, n_rows);
+        free_hyb_d(&hyb);
+    }
+    printf("\n");
+    run_bcsr(&crs, x, y_crs, y_par);
+
+    crs_delta_d_t cd;
+    if (build_crs_delta_from_crs_double(&crs, &cd)) {
+        printf("\n");
+        bench_crs_delta_double(&crs, &cd, x, y_par, 1000);
+        crs_delta_spmv_double(&cd, x, y_par);
+        verify_double("crs_delta", y_crs, y_par, n_rows);
+        free_crs_delta_d(&cd);
+    }
+
+    for (int q = 0; q < 3; q++) {
+        if (have_sell[q]) {
+            sell_spmv_double_simd(&sell[q], x, y_par);
+            verify_double("sell", y_crs, y_par, n_rows);
+            free_sell_d(&sell[q]);
+        }
+    }
+    for (int m = 0; m < 3; m++) {
+        if (have_tjds_plan[m]) {
+            tjds_spmv_double_par(&tjds, &tjds_plan[m], x, y_par);
+            verify_double(m == SCATTER_AUTO ? "tjds_par" : (m == SCATTER_PRIVATE ? "tjds_priv" : "tjds_own"),
+                          y_crs, y_par, n_rows);
+            free_scatter_plan(&tjds_plan[m]);
+        }
+        if (have_ccs_plan[m]) {
+            ccs_spmv_double_par(&ccs, &ccs_plan[m], x, y_par);
+            verify_double(m == SCATTER_AUTO ? "ccs_par" : (m == SCATTER_PRIVATE ? "ccs_priv" : "ccs_own"),
+                          y_crs, y_par, n_rows);
+            free_scatter_plan(&ccs_plan[m]);
+        }
+    }
     printf("\n");
 
     free(x);
     free(y_crs);
     free(y_tjds);
-    free_tjds_d(&tjds);
-    free_ccs_d(&ccs);
+    free(y_par);
+    release_memplus(mapped, &bin, &crs, &ccs, &tjds);
+}
+
+static int same_crs_d(const crs_d_t *a, const crs_d_t *b) {
+    if (a->n_rows != b->n_rows || a->n_cols != b->n_cols || a->nnz != b->nnz) return 0;
+    return memcmp(a->row_ptr, b->row_ptr, (size_t)(a->n_rows + 1) * sizeof(int)) == 0 &&
+           memcmp(a->col_idx, b->col_idx, (size_t)a->nnz * sizeof(int)) == 0 &&
+           memcmp(a->values, b->values, (size_t)a->nnz * sizeof(double)) == 0;
+}
+
+//the two pipelines as forked_peak_rss_kb bodies, each one builds the crs and throws it away
+static int triplet_pipeline(void *path) {
+    triplet_d_t *t = NULL;
+    int n_rows = 0, n_cols = 0, nnz = 0;
+    crs_d_t crs;
+    if (!mm_read_triplets_double_mmap((const char *)path, &t, &n_rows, &n_cols, &nnz, NULL)) return 0;
+    int ok = build_crs_from_triplets_double(n_rows, n_cols, t, nnz, &crs);
+    free(t);
+    if (ok) free_crs_d(&crs);
+    return ok;
+}
+
+static int stream_pipeline(void *path) {
+    crs_d_t crs;
+    if (!mm_build_crs_double_stream((const char *)path, &crs, NULL)) return 0;
     free_crs_d(&crs);
+    return 1;
+}
+
+//current pipeline (file -> triplets -> crs) vs the two pass streaming builder. memory is the peak rss
+//growth of each pipeline run alone in a forked child, the mapped file pages are part of both
+void run_stream_build(const char *mtx_path) {
+    printf("=== streaming .mtx -> CRS ===\n");
+
+    long long t0 = now_ns();
+    triplet_d_t *t = NULL;
+    int n_rows = 0, n_cols = 0, nnz = 0;
+    mm_stats_t load;
+    crs_d_t ref;
+    if (!mm_read_triplets_double_mmap(mtx_path, &t, &n_rows, &n_cols, &nnz, &load)) {
+        printf("couldn't open %s (skipping)\n\n", mtx_path);
+        return;
+    }
+    if (!build_crs_from_triplets_double(n_rows, n_cols, t, nnz, &ref)) {
+        fprintf(stderr, "failed building crs(double)\n");
+        free(t);
+        return;
+    }
+    free(t);
+    long long t1 = now_ns();
+
+    crs_d_t crs;
+    mm_stats_t st;
+    if (!mm_build_crs_double_stream(mtx_path, &crs, &st)) {
+        fprintf(stderr, "streaming build failed\n");
+        free_crs_d(&ref);
+        return;
+    }
+
+    long long kb0 = forked_peak_rss_kb(triplet_pipeline, (void *)mtx_path);
+    long long kb1 = forked_peak_rss_kb(stream_pipeline, (void *)mtx_path);
+    //crs arrays alone, the floor either pipeline has to reach
+    long long crs_bytes = (long long)nnz * (long long)(sizeof(double) + sizeof(int)) +
+                          (long long)(n_rows + 1) * (long long)sizeof(int);
+
+    printf("file = %s (%.2f MB mapped)  crs arrays = %.2f MB\n", mtx_path, (double)load.bytes / 1e6,
+           (double)crs_bytes / 1e6);
+    if (kb0 < 0 || kb1 < 0) {
+        printf("triplets+build: time = %.3f ms\n", (double)(t1 - t0) / 1e6);
+        printf("stream:         time = %.3f ms\n", (double)st.time_ns / 1e6);
+        printf("(no fork or /proc, peak rss not measured)\n");
+    } else {
+        printf("triplets+build: time = %.3f ms  peak rss growth = %.2f MB\n", (double)(t1 - t0) / 1e6,
+               (double)kb0 / 1e3);
+        printf("stream:         time = %.3f ms  peak rss growth = %.2f MB\n", (double)st.time_ns / 1e6,
+               (double)kb1 / 1e3);
+    }
+
+    if (same_crs_d(&ref, &crs))
+		printf("ok: crs arrays match\n\n");
+    else
+		printf("bruh: streaming crs differs\n\n");
+
+    free_crs_d(&crs);
+    free_crs_d(&ref);
+}
+
+static int same_crs(const crs_t *a, const crs_t *b) {
+    if (a->n_rows != b->n_rows || a->n_cols != b->n_cols || a->nnz != b->nnz) return 0;
+    return memcmp(a->row_ptr, b->row_ptr, (size_t)(a->n_rows + 1) * sizeof(int)) == 0 &&
+           memcmp(a->col_idx, b->col_idx, (size_t)a->nnz * sizeof(int)) == 0 &&
+           memcmp(a->values, b->values, (size_t)a->nnz * sizeof(int)) == 0;
+}
+
+//the fscanf and mmap readers of one file must give the same crs (values bit for bit)
+static void mmap_vs_fscanf_double(const char *label, const char *path) {
+    triplet_d_t *t0 = NULL, *t1 = NULL;
+    int r0, c0, n0, r1, c1, n1;
+    crs_d_t a, b;
+    int have_a = mm_read_triplets_double(path, &t0, &r0, &c0, &n0) && build_crs_from_triplets_double(r0, c0, t0, n0, &a);
+    int have_b = mm_read_triplets_double_mmap(path, &t1, &r1, &c1, &n1, NULL) &&
+                 build_crs_from_triplets_double(r1, c1, t1, n1, &b);
+    free(t0);
+    free(t1);
+    if (!have_a || !have_b) printf("  double %s bruh: read failed\n", label);
+    else printf("  double %s nnz = %d %s\n", label, b.nnz, same_crs_d(&a, &b) ? "ok" : "bruh: mismatch");
+    if (have_a) free_crs_d(&a);
+    if (have_b) free_crs_d(&b);
+}
+
+static void mmap_vs_fscanf_int(const char *path) {
+    triplet_t *t0 = NULL, *t1 = NULL;
+    int r0, c0, n0, r1, c1, n1;
+    crs_t a, b;
+    int have_a = mm_read_triplets_int(path, &t0, &r0, &c0, &n0) && build_crs_from_triplets(r0, c0, t0, n0, &a);
+    int have_b = mm_read_triplets_int_mmap(path, &t1, &r1, &c1, &n1, NULL) &&
+                 build_crs_from_triplets(r1, c1, t1, n1, &b);
+    free(t0);
+    free(t1);
+    if (!have_a || !have_b) printf("  int    %s bruh: read failed\n", path);
+    else printf("  int    %s nnz = %d %s\n", path, b.nnz, same_crs(&a, &b) ? "ok" : "bruh: mismatch");
+    if (have_a) free_crs(&a);
+    if (have_b) free_crs(&b);
+}
+
+//a small file of signed zeros and values on the strtod path (long mantissa, big exponent),
+//checked through both readers
+static void mmap_signed_zero_check(void) {
+    char path[] = "/tmp/mmap_check_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        printf("  couldn't create a temp file (skipping)\n");
+        return;
+    }
+    FILE *f = fdopen(fd, "w");
+    if (!f) {
+        close(fd);
+        unlink(path);
+        return;
+    }
+    fprintf(f, "%%%%MatrixMarket matrix coordinate real general\n4 4 4\n");
+    fprintf(f, "1 1 -0\n2 2 -0.0e3\n3 3 -1.2345678901234567890123e-300\n4 4 +0\n");
+    fclose(f);
+
+    triplet_d_t *t = NULL;
+    int r, c, n;
+    int ok = mm_read_triplets_double_mmap(path, &t, &r, &c, &n, NULL) && n == 4 &&
+             t[0].v == 0.0 && signbit(t[0].v) && t[1].v == 0.0 && signbit(t[1].v) &&
+             t[2].v == -1.2345678901234567890123e-300 && t[3].v == 0.0 && !signbit(t[3].v);
     free(t);
+    printf("  signed zeros / strtod path %s\n", ok ? "ok" : "bruh: mismatch");
+    mmap_vs_fscanf_double("signed zeros", path);
+    unlink(path);
+}
+
+void run_mmap_check(const char *int_path, const char *double_path) {
+    printf("=== mmap vs fscanf readers ===\n");
+    mmap_vs_fscanf_int(int_path);
+    mmap_vs_fscanf_double(double_path, double_path);
+    mmap_signed_zero_check();
+    printf("\n");
+}
+
+void run_build_bench(const char *mtx_path) {
+    triplet_d_t *t = NULL;
+    int n_rows = 0, n_cols = 0, nnz = 0;
+
+    printf("=== build benchmarks ===\n");
+    if (!mm_read_triplets_double_mmap(mtx_path, &t, &n_rows, &n_cols, &nnz, NULL)) {
+        printf("couldn't open %s (skipping)\n\n", mtx_path);
+        return;
+    }
+    printf("file = %s\n", mtx_path);
+
+    bench_build_threads(n_rows, n_cols, t, nnz, get_num_threads(), 5);
+
+    ccs_d_t ccs;
+    if (build_ccs_from_triplets_double(n_rows, n_cols, t, nnz, &ccs)) {
+        bench_build_tjds(&ccs, 3);
+        free_ccs_d(&ccs);
+    }
+    printf("\n");
+
+    free(t);
+}
+
+static void merge_vs_par(const char *label, const crs_d_t *a, int iters) {
+    double *x = (double *)malloc((size_t)a->n_cols * sizeof(double));
+    double *y_ref = (double *)malloc((size_t)a->n_rows * sizeof(double));
+    double *y = (double *)malloc((size_t)a->n_rows * sizeof(double));
+    if (!x || !y_ref || !y) {
+        fprintf(stderr, "malloc failed\n");
+        free(x); free(y_ref); free(y);
+        return;
+    }
+
+    int max_row = 0;
+    for (int i = 0; i < a->n_rows; i++) {
+        int len = a->row_ptr[i + 1] - a->row_ptr[i];
+        if (len > max_row) max_row = len;
+    }
+    printf("%s: nRows = %d nnz = %d longest row = %d (%.1f%% of nnz)\n",
+           label, a->n_rows, a->nnz, max_row, 100.0 * max_row / (a->nnz ? a->nnz : 1));
+
+    for (int i = 0; i < a->n_cols; i++)
+		x[i] = 1.0;
+    crs_spmv_double(a, x, y_ref);
+
+    bench_crs_double(a, x, y, iters);
+
+    crs_part_t part;
+    if (crs_partition_nnz(a, get_num_threads(), &part)) {
+        bench_crs_double_par(a, &part, x, y, iters);
+        verify_double("crs_par", y_ref, y, a->n_rows);
+        free_crs_part(&part);
+    }
+
+    crs_merge_t merge;
+    if (crs_merge_plan(a, get_num_threads(), &merge)) {
+        bench_crs_double_merge(a, &merge, x, y, iters);
+        verify_double("crs_merge", y_ref, y, a->n_rows);
+        free_crs_merge(&merge);
+    }
+    printf("\n");
+
+    free(x);
+    free(y_ref);
+    free(y);
+}
+
+void run_merge_bench(const char *mtx_path) {
+    printf("=== merge path vs row parallel crs ===\n");
+
+    crs_d_t crs;
+    if (mm_build_crs_double_stream(mtx_path, &crs, NULL)) {
+        merge_vs_par(mtx_path, &crs, 1000);
+        free_crs_d(&crs);
+    } else {
+        printf("couldn't open %s (skipping)\n\n", mtx_path);
+    }
+
+    crs_d_t pl;
+    if (gen_powerlaw_crs(200000, 200000, 2000000, 1.0, 42, &pl)) {
+        merge_vs_par("powerlaw alpha=1.0", &pl, 100);
+        free_crs_d(&pl);
+    }
+}
+
+static void delta_vs_crs(const char *label, const crs_d_t *a, int iters) {
+    double *x = (double *)malloc((size_t)a->n_cols * sizeof(double));
+    double *y_ref = (double *)malloc((size_t)a->n_rows * sizeof(double));
+    double *y = (double *)malloc((size_t)a->n_rows * sizeof(double));
+    crs_delta_d_t cd;
+    if (x && y_ref && y && build_crs_delta_from_crs_double(a, &cd)) {
+        for (int i = 0; i < a->n_cols; i++)
+			x[i] = 1.0 / (i + 1);
+        crs_spmv_double(a, x, y_ref);
+
+        printf("%s: nRows = %d nnz = %d\n", label, a->n_rows, a->nnz);
+        bench_crs_delta_double(a, &cd, x, y, iters);
+        crs_delta_spmv_double(&cd, x, y);
+        verify_double("crs_delta", y_ref, y, a->n_rows);
+        free_crs_delta_d(&cd);
+    }
+    printf("\n");
+
+    free(x);
+    free(y_ref);
+    free(y);
+}
+
+//memplus fits in cache, so the index savings only show on matrices that stream from memory.
+//banded is the friendly case (small gaps), powerlaw has random columns and plenty of escapes
+void run_delta_bench(void) {
+    printf("=== 16-bit delta column index crs ===\n");
+
+    crs_d_t band;
+    if (gen_banded_crs(1000000, 2000, 8, 7, &band)) {
+        delta_vs_crs("banded bw=2000", &band, 50);
+        free_crs_d(&band);
+    }
+
+    crs_d_t pl;
+    if (gen_powerlaw_crs(200000, 200000, 2000000, 1.0, 42, &pl)) {
+        delta_vs_crs("powerlaw alpha=1.0", &pl, 100);
+        free_crs_d(&pl);
+    }
+}
+
+//writes sym as a (skew-)symmetric .mtx, then checks the folding stream reader against the full stream
+//reader + build_crs_sym_from_crs_double. upper = 1 stores the triangle as j > i so the fold runs
+static void sym_stream_check(const crs_sym_d_t *sym, int upper, const double *x, double *y_ref, double *y) {
+    char path[] = "/tmp/sym_check_XXXXXX";
+    char name[32];
+    snprintf(name, sizeof(name), "%s %s", sym->skew ? "skew" : "sym", upper ? "upper" : "lower");
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        printf("  couldn't create a temp file (skipping)\n");
+        return;
+    }
+    close(fd);
+    if (!mm_write_crs_sym_double(path, sym, upper, "sym_stream_check")) {
+        printf("  couldn't write %s (skipping)\n", path);
+        unlink(path);
+        return;
+    }
+
+    crs_d_t full;
+    crs_sym_d_t ref, got;
+    int have_full = mm_build_crs_double_stream(path, &full, NULL);
+    int have_ref = have_full && build_crs_sym_from_crs_double(&full, sym->skew, &ref);
+    int have_got = mm_build_crs_sym_double_stream(path, &got, NULL);
+    unlink(path);
+    if (!have_ref || !have_got) {
+        printf("  stream %-10s bruh: read failed\n", name);
+    } else {
+        //rows keep file order, so compare shapes exactly and the entries through y
+        int same = got.n == ref.n && got.nnz == ref.nnz && got.nnz_full == ref.nnz_full && got.skew == ref.skew &&
+                   memcmp(got.row_ptr, ref.row_ptr, (size_t)(ref.n + 1) * sizeof(int)) == 0;
+        double err = 0.0;
+        if (same) {
+            crs_sym_spmv_double(&ref, x, y_ref);
+            crs_sym_spmv_double(&got, x, y);
+            for (int i = 0; i < ref.n; i++) {
+                double d = y[i] - y_ref[i];
+                if (d < 0) d = -d;
+                if (d > err) err = d;
+            }
+        }
+        printf("  stream %-10s nnz = %d max err = %.3g %s\n", name, got.nnz, err,
+               (same && err <= 1e-12) ? "ok" : "bruh: mismatch");
+    }
+    if (have_full) free_crs_d(&full);
+    if (have_ref) free_crs_sym_d(&ref);
+    if (have_got) free_crs_sym_d(&got);
+}
+
+//a copy of a without its diagonal entries, so the lower triangle can stand in for a skew matrix
+static int drop_diagonal(const crs_d_t *a, crs_d_t *out) {
+    crs_d_t c;
+    c.n_rows = a->n_rows;
+    c.n_cols = a->n_cols;
+    c.nnz = 0;
+    c.values = (double *)malloc((size_t)a->nnz * sizeof(double) + 1);
+    c.col_idx = (int *)malloc((size_t)a->nnz * sizeof(int) + 1);
+    c.row_ptr = (int *)malloc((size_t)(a->n_rows + 1) * sizeof(int));
+    if (!c.values || !c.col_idx || !c.row_ptr) {
+        free_crs_d(&c);
+        return 0;
+    }
+
+    c.row_ptr[0] = 0;
+    for (int i = 0; i < a->n_rows; i++) {
+        for (int k = a->row_ptr[i]; k < a->row_ptr[i + 1]; k++) {
+            if (a->col_idx[k] == i) continue;
+            c.values[c.nnz] = a->values[k];
+            c.col_idx[c.nnz] = a->col_idx[k];
+            c.nnz++;
+        }
+        c.row_ptr[i + 1] = c.nnz;
+    }
+    *out = c;
+    return 1;
+}
+
+//memplus is general, so its lower triangle stands in for a symmetric matrix, and the lower
+//triangle without the diagonal for a skew one
+void run_sym_bench(const char *mtx_path) {
+    printf("=== symmetric half storage ===\n");
+
+    crs_d_t crs;
+    if (!mm_build_crs_double_stream(mtx_path, &crs, NULL)) {
+        printf("couldn't open %s (skipping)\n\n", mtx_path);
+        return;
+    }
+
+    double *x = (double *)malloc((size_t)crs.n_cols * sizeof(double));
+    double *y_ref = (double *)malloc((size_t)crs.n_rows * sizeof(double));
+    double *y = (double *)malloc((size_t)crs.n_rows * sizeof(double));
+    if (!x || !y_ref || !y) {
+        free(x); free(y_ref); free(y);
+        free_crs_d(&crs);
+        return;
+    }
+    for (int i = 0; i < crs.n_cols; i++)
+		x[i] = 1.0 / (i + 1);
+
+    crs_d_t no_diag;
+    int have_no_diag = drop_diagonal(&crs, &no_diag);
+    for (int skew = 0; skew <= 1; skew++) {
+        crs_sym_d_t sym;
+        crs_d_t full;
+        sym_plan_t plan;
+        if (skew && !have_no_diag) continue;
+        if (!build_crs_sym_from_crs_double(skew ? &no_diag : &crs, skew, &sym)) {
+            printf("  %s build bruh: failed\n", skew ? "skew" : "sym");
+            continue;
+        }
+        if (!crs_sym_expand_double(&sym, &full)) { free_crs_sym_d(&sym); continue; }
+        if (!crs_sym_plan(&sym, get_num_threads(), &plan)) { free_crs_d(&full); free_crs_sym_d(&sym); continue; }
+
+        crs_spmv_double(&full, x, y_ref);
+        bench_crs_sym_double(&full, &sym, &plan, x, y, 1000);
+
+        crs_sym_spmv_double(&sym, x, y);
+        verify_double("sym", y_ref, y, sym.n);
+        crs_sym_spmv_double_par(&sym, &plan, x, y);
+        verify_double("sym_par", y_ref, y, sym.n);
+        for (int upper = 0; upper <= 1; upper++)
+			sym_stream_check(&sym, upper, x, y_ref, y);
+
+        free_sym_plan(&plan);
+        free_crs_d(&full);
+        free_crs_sym_d(&sym);
+    }
+    printf("\n");
+
+    if (have_no_diag) free_crs_d(&no_diag);
+    free(x);
+    free(y_ref);
+    free(y);
+    free_crs_d(&crs);
 }
 
+//best of three runs of iters spmv, in ns per call
+static double time_variant(const spmv_variant_t *v, void *h, const double *x, double *y, int iters) {
+    double best = 0.0;
+    for (int rep = 0; rep < 3; rep++) {
+        long long t0 = now_ns();
+        for (int k = 0; k < iters; k++) v->run(h, x, y);
+        double per = (double)(now_ns() - t0) / iters;
+        if (rep == 0 || per < best) best = per;
+    }
+    return best;
+}
+
+//every registered format on the original and the rcm reordered matrix, x permuted once up
+//front and y permuted back only for the check
+static void rcm_compare(const char *label, const crs_d_t *a, int iters) {
+    int n = a->n_rows;
+    int *perm = (int *)malloc((size_t)n * sizeof(int) + 1);
+    double *x = (double *)malloc((size_t)n * sizeof(double) + 1);
+    double *xp = (double *)malloc((size_t)n * sizeof(double) + 1);
+    double *y_ref = (double *)malloc((size_t)n * sizeof(double) + 1);
+    double *yp = (double *)malloc((size_t)n * sizeof(double) + 1);
+    double *y = (double *)malloc((size_t)n * sizeof(double) + 1);
+    crs_d_t b;
+    long long t0 = now_ns();
+    if (!perm || !x || !xp || !y_ref || !yp || !y || !rcm_order(a, perm) || !crs_permute_sym(a, perm, &b)) {
+        printf("rcm failed\n\n");
+        free(perm); free(x); free(xp); free(y_ref); free(yp); free(y);
+        return;
+    }
+    long long t1 = now_ns();
+
+    printf("%s: nRows = %d nnz = %d rcm + permute %.3f ms\n", label, n, a->nnz, (double)(t1 - t0) / 1e6);
+    printf("bandwidth %d -> %d, profile %lld -> %lld\n", crs_bandwidth(a), crs_bandwidth(&b),
+           crs_profile(a), crs_profile(&b));
 
+    for (int i = 0; i < n; i++)
+		x[i] = 1.0 / (i + 1);
+    crs_spmv_double(a, x, y_ref);
+    permute_vec(perm, n, x, xp);
+
+    //crs with the permutes inside the timed loop, what a caller pays without keeping x permuted
+    long long t2 = now_ns();
+    for (int k = 0; k < iters; k++) {
+        permute_vec(perm, n, x, xp);
+        crs_spmv_double(&b, xp, yp);
+        unpermute_vec(perm, n, yp, y);
+    }
+    long long t3 = now_ns();
+    printf("crs + permute in/out %.0f ns per spmv\n", (double)(t3 - t2) / iters);
+    verify_double("crs_rcm", y_ref, y, n);
+
+    printf("%-10s %12s %12s %8s\n", "format", "orig ns", "rcm ns", "speedup");
+    for (int q = 0; q < spmv_variant_count(); q++) {
+        const spmv_variant_t *v = spmv_variant_at(q);
+        void *ha = v->build(a, get_num_threads());
+        void *hb = v->build(&b, get_num_threads());
+        if (!ha || !hb) {
+            printf("%-10s skipped (build failed)\n", v->name);
+            if (ha) v->release(ha);
+            if (hb) v->release(hb);
+            continue;
+        }
+
+        double ta = time_variant(v, ha, x, y, iters);
+        double tb = time_variant(v, hb, xp, yp, iters);
+        printf("%-10s %12.0f %12.0f %7.2fx\n", v->name, ta, tb, ta / tb);
+
+        unpermute_vec(perm, n, yp, y);
+        verify_double_tol(v->name, y_ref, y, n, v->tol);
+        v->release(ha);
+        v->release(hb);
+    }
+    printf("\n");
+
+    free(perm); free(x); free(xp); free(y_ref); free(yp); free(y);
+    free_crs_d(&b);
+}
+
+//memplus fits in cache and has a few dense rows, so the second case is a banded matrix put
+//through a random symmetric permutation, which rcm should mostly undo
+void run_rcm_bench(const char *mtx_path) {
+    printf("=== rcm reordering ===\n");
+
+    crs_d_t a;
+    if (mm_build_crs_double_stream(mtx_path, &a, NULL)) {
+        rcm_compare(mtx_path, &a, 200);
+        free_crs_d(&a);
+    } else {
+        printf("couldn't open %s (skipping)\n\n", mtx_path);
+    }
+
+    crs_d_t band, scrambled;
+    int n = 500000;
+    int *shuffle = (int *)malloc((size_t)n * sizeof(int));
+    if (shuffle && gen_banded_crs(n, 50, 8, 11, &band)) {
+        gen_random_perm(n, 12, shuffle);
+        if (crs_permute_sym(&band, shuffle, &scrambled)) {
+            rcm_compare("scrambled banded bw=50", &scrambled, 20);
+            free_crs_d(&scrambled);
+        }
+        free_crs_d(&band);
+    }
+    free(shuffle);
+}
 
+//no arguments runs the fixed Q1-Q4 suite below, anything else goes to the benchmark driver
+int main(int argc, char **argv) {
+    if (argc > 1)
+		return bench_driver_main(argc, argv);
 
-int main(void) {
     demo_q1();
-    run_ibm32_dense("ibm32.mtx");
-    run_memplus_sparse("memplus.mtx");
+    run_ibm32_sparse("ibm32.mtx");
+    run_memplus_sparse("memplus.mtx", "memplus.smx");
+    run_stream_build("memplus.mtx");
+    run_mmap_check("ibm32.mtx", "memplus.mtx");
+    run_build_bench("memplus.mtx");
+    run_merge_bench("memplus.mtx");
+    run_delta_bench();
+    run_sym_bench("memplus.mtx");
+    run_rcm_bench("memplus.mtx");
     return 0;
 }
 
@@ -1,8 +1,16 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "matrix_multiply_io.h"
+#include "util.h"
 
 int mm_read_dense_int(const char *path, int **out_a, int *out_rows, int *out_cols, int *out_nnz) {
     FILE *f = fopen(path, "r");
@@ -204,3 +212,520 @@ int mm_read_triplets_double(const char *path, triplet_d_t **out_t, int *out_rows
     return 1;
 }
 
+
+
+/* ---- mmap loader ---- */
+
+typedef struct { int fd; char *base; size_t size; } mm_map_t;
+
+typedef struct {
+    const char *body, *end;
+    int n_rows, n_cols, nnz;
+    int is_pattern, symmetric;
+} mm_header_t;
+
+static const double pow10_tab[23] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static int mm_map_file(const char *path, mm_map_t *m) {
+    m->fd = open(path, O_RDONLY);
+    if (m->fd < 0) return 0;
+
+    struct stat st;
+    if (fstat(m->fd, &st) != 0 || st.st_size <= 0) { close(m->fd); return 0; }
+    m->size = (size_t)st.st_size;
+
+    void *p = mmap(NULL, m->size, PROT_READ, MAP_PRIVATE, m->fd, 0);
+    if (p == MAP_FAILED) { close(m->fd); return 0; }
+    posix_madvise(p, m->size, POSIX_MADV_SEQUENTIAL);
+
+    m->base = (char *)p;
+    return 1;
+}
+
+static void mm_unmap_file(mm_map_t *m) {
+    munmap(m->base, m->size);
+    close(m->fd);
+}
+
+static const char *skip_ws(const char *p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+    return p;
+}
+
+static const char *next_line(const char *p, const char *end) {
+    const char *nl = (const char *)memchr(p, '\n', (size_t)(end - p));
+    return nl ? nl + 1 : end;
+}
+
+static int parse_int(const char **pp, const char *end, int *out) {
+    const char *p = skip_ws(*pp, end);
+    int neg = 0;
+    if (p < end && (*p == '-' || *p == '+')) { neg = (*p == '-'); p++; }
+    if (p >= end || *p < '0' || *p > '9') return 0;
+
+    long long v = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        v = v * 10 + (*p - '0');
+        if (v > INT_MAX) return 0;
+        p++;
+    }
+
+    *out = neg ? -(int)v : (int)v;
+    *pp = p;
+    return 1;
+}
+
+//exact when the mantissa fits in 53 bits and |exp| <= 22 (one correctly rounded mul/div),
+//everything else goes through strtod so the result always matches fscanf. the sign is taken
+//off first and put back on the magnitude at the end, so "-0" stays -0.0 on every path
+static int parse_double(const char **pp, const char *end, double *out) {
+    const char *p = skip_ws(*pp, end);
+    int neg = 0;
+    if (p < end && (*p == '-' || *p == '+')) { neg = (*p == '-'); p++; }
+    const char *start = p;
+
+    unsigned long long mant = 0;
+    int ndig = 0, exp10 = 0, any = 0, slow = 0;
+
+    while (p < end && *p >= '0' && *p <= '9') {
+        if (ndig < 19) {
+            mant = mant * 10 + (unsigned)(*p - '0');
+            if (mant) ndig++;
+        } else {
+            exp10++;
+            slow = 1;
+        }
+        p++;
+        any = 1;
+    }
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (ndig < 19) {
+                mant = mant * 10 + (unsigned)(*p - '0');
+                if (mant) ndig++;
+                exp10--;
+            } else {
+                slow = 1;
+            }
+            p++;
+            any = 1;
+        }
+    }
+    if (!any) return 0;
+
+    if (p < end && (*p == 'e' || *p == 'E' || *p == 'd' || *p == 'D')) {
+        p++;
+        int eneg = 0, e = 0;
+        if (p < end && (*p == '-' || *p == '+')) { eneg = (*p == '-'); p++; }
+        if (p >= end || *p < '0' || *p > '9') return 0;
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (e < 100000) e = e * 10 + (*p - '0');
+            p++;
+        }
+        exp10 += eneg ? -e : e;
+    }
+
+    double v;
+    if (mant == 0) {
+        v = 0.0;
+    } else if (!slow && mant <= (1ULL << 53) && exp10 >= -22 && exp10 <= 22) {
+        v = (double)mant;
+        v = (exp10 < 0) ? v / pow10_tab[-exp10] : v * pow10_tab[exp10];
+    } else {
+        char buf[128];
+        size_t len = (size_t)(p - start);
+        if (len >= sizeof(buf)) return 0;
+        for (size_t q = 0; q < len; q++) {
+            char ch = start[q];
+            buf[q] = (ch == 'd' || ch == 'D') ? 'e' : ch;
+        }
+        buf[len] = '\0';
+        v = strtod(buf, NULL);
+    }
+
+    *out = neg ? -v : v;
+    *pp = p;
+    return 1;
+}
+
+//1 = got an entry (1 based i,j like the file), 0 = end of range, -1 = bad line
+static int mm_next_entry(const char **pp, const char *end, int is_pattern, int *i, int *j, double *v) {
+    const char *p = *pp;
+    while (p < end) {
+        p = skip_ws(p, end);
+        if (p < end && *p != '\n' && *p != '%') break;
+        p = next_line(p, end);
+    }
+    if (p >= end) { *pp = end; return 0; }
+
+    if (!parse_int(&p, end, i) || !parse_int(&p, end, j)) return -1;
+    *v = 1.0;
+    if (!is_pattern && !parse_double(&p, end, v)) return -1;
+
+    *pp = next_line(p, end);
+    return 1;
+}
+
+static long long count_data_lines(const char *p, const char *end) {
+    long long n = 0;
+    while (p < end) {
+        p = skip_ws(p, end);
+        if (p < end && *p != '\n' && *p != '%') n++;
+        p = next_line(p, end);
+    }
+    return n;
+}
+
+static int mm_parse_header(const char *p, const char *end, mm_header_t *h) {
+    if (end - p < 2 || p[0] != '%' || p[1] != '%') return 0;
+
+    const char *eol = next_line(p, end);
+    char line[512];
+    size_t len = (size_t)(eol - p);
+    if (len >= sizeof(line)) len = sizeof(line) - 1;
+    memcpy(line, p, len);
+    line[len] = '\0';
+
+    h->is_pattern = 0;
+    h->symmetric = 0;
+    if (strstr(line, "pattern")) h->is_pattern = 1;
+    if (strstr(line, "skew-symmetric")) h->symmetric = 2;
+    else if (strstr(line, "symmetric")) h->symmetric = 1;
+
+    p = eol;
+    while (p < end) {
+        const char *q = skip_ws(p, end);
+        if (q < end && *q != '%' && *q != '\n') break;
+        p = next_line(q, end);
+    }
+
+    if (!parse_int(&p, end, &h->n_rows) || !parse_int(&p, end, &h->n_cols) || !parse_int(&p, end, &h->nnz))
+		return 0;
+    if (h->n_rows < 0 || h->n_cols < 0 || h->nnz < 0) return 0;
+
+    h->body = next_line(p, end);
+    h->end = end;
+    return 1;
+}
+
+//splits the body into nt newline aligned chunks [bound[c], bound[c+1]) and counts the
+//data lines in each one, first[c] = index of the first entry of chunk c in file order
+static int mm_split_chunks(const mm_header_t *h, int nt, const char **bound, long long *first) {
+    size_t len = (size_t)(h->end - h->body);
+
+    bound[0] = h->body;
+    bound[nt] = h->end;
+    for (int c = 1; c < nt; c++) {
+        const char *p = h->body + len * (size_t)c / (size_t)nt;
+        if (p < bound[c - 1]) p = bound[c - 1];
+        if (p > h->body && p < h->end && p[-1] != '\n') p = next_line(p, h->end);
+        bound[c] = p;
+    }
+
+    first[0] = 0;
+    #pragma omp parallel for num_threads(nt) schedule(static, 1)
+    for (int c = 0; c < nt; c++)
+        first[c + 1] = count_data_lines(bound[c], bound[c + 1]);
+
+    for (int c = 0; c < nt; c++)
+		first[c + 1] += first[c];
+
+    return first[nt] >= h->nnz;
+}
+
+//chunks were parsed into worst case slots (2 per line when symmetric), pull them together in order
+static long long mm_compact(void *t, size_t elem, int nt, const long long *first, const long long *used, int symmetric) {
+    char *base = (char *)t;
+    long long pos = 0;
+    for (int c = 0; c < nt; c++) {
+        long long src = symmetric ? 2 * first[c] : first[c];
+        if (used[c] > 0 && src != pos)
+			memmove(base + (size_t)pos * elem, base + (size_t)src * elem, (size_t)used[c] * elem);
+        pos += used[c];
+    }
+    return pos;
+}
+
+static void mm_fill_stats(mm_stats_t *stats, const mm_map_t *m, long long t0, int nt, long long peak_bytes) {
+    if (!stats) return;
+    stats->bytes = (long long)m->size;
+    stats->peak_bytes = peak_bytes;
+    stats->time_ns = now_ns() - t0;
+    stats->threads = nt;
+}
+
+//writes entry w of a chunk's output, the one place the int and double readers differ
+typedef void (*mm_store_fn)(void *dst, long long w, int i, int j, double v);
+
+static void store_triplet_d(void *dst, long long w, int i, int j, double v) {
+    ((triplet_d_t *)dst)[w] = (triplet_d_t){ .i = i, .j = j, .v = v };
+}
+
+static void store_triplet_i(void *dst, long long w, int i, int j, double v) {
+    ((triplet_t *)dst)[w] = (triplet_t){ .i = i, .j = j, .v = (int)v };
+}
+
+//shared body of the mmap readers: header, chunk split, parallel parse into elem sized slots
+//through store, compaction. skew mirrors get -v, which (int) truncates to -(int)v as before
+static int mm_read_triplets_mmap(const char *path, size_t elem, mm_store_fn store, void **out_t, int *out_rows,
+                                 int *out_cols, int *out_nnz, mm_stats_t *stats) {
+    long long t0 = now_ns();
+
+    mm_map_t m;
+    if (!mm_map_file(path, &m)) return 0;
+
+    mm_header_t h;
+    if (!mm_parse_header(m.base, m.base + m.size, &h)) { mm_unmap_file(&m); return 0; }
+
+    int nt = get_num_threads();
+    const char **bound = (const char **)malloc((size_t)(nt + 1) * sizeof(char *));
+    long long *first = (long long *)malloc((size_t)(nt + 1) * sizeof(long long));
+    long long *used = (long long *)calloc((size_t)nt, sizeof(long long));
+    size_t cap = (size_t)(h.symmetric ? 2 * (long long)h.nnz : h.nnz);
+    char *t = (char *)malloc((cap ? cap : 1) * elem);
+    if (!bound || !first || !used || !t || !mm_split_chunks(&h, nt, bound, first)) {
+        free(bound); free(first); free(used); free(t);
+        mm_unmap_file(&m);
+        return 0;
+    }
+
+    int err = 0;
+    #pragma omp parallel for num_threads(nt) schedule(static, 1) reduction(|:err)
+    for (int c = 0; c < nt; c++) {
+        if (first[c] >= h.nnz) continue;
+        long long todo = (first[c + 1] < h.nnz ? first[c + 1] : h.nnz) - first[c];
+        void *dst = t + (size_t)(h.symmetric ? 2 * first[c] : first[c]) * elem;
+        const char *p = bound[c];
+        long long w = 0;
+
+        for (long long n = 0; n < todo; n++) {
+            int i = 0, j = 0;
+            double v = 1.0;
+            if (mm_next_entry(&p, bound[c + 1], h.is_pattern, &i, &j, &v) != 1) { err = 1; break; }
+
+            i--; j--;
+            if (i < 0 || i >= h.n_rows || j < 0 || j >= h.n_cols) { err = 1; break; }
+
+            store(dst, w++, i, j, v);
+            if (h.symmetric && i != j)
+				store(dst, w++, j, i, (h.symmetric == 2) ? -v : v);
+        }
+        used[c] = w;
+    }
+
+    long long total = err ? 0 : mm_compact(t, elem, nt, first, used, h.symmetric);
+
+    free(bound);
+    free(first);
+    free(used);
+
+    if (err || total > INT_MAX) {
+        free(t);
+        mm_unmap_file(&m);
+        return 0;
+    }
+
+    mm_fill_stats(stats, &m, t0, nt, (long long)cap * (long long)elem);
+    mm_unmap_file(&m);
+
+    *out_t = t;
+    *out_rows = h.n_rows;
+    *out_cols = h.n_cols;
+    *out_nnz = (int)total;
+    return 1;
+}
+
+int mm_read_triplets_double_mmap(const char *path, triplet_d_t **out_t, int *out_rows, int *out_cols, int *out_nnz, mm_stats_t *stats) {
+    void *t;
+    if (!mm_read_triplets_mmap(path, sizeof(triplet_d_t), store_triplet_d, &t, out_rows, out_cols, out_nnz, stats))
+		return 0;
+    *out_t = (triplet_d_t *)t;
+    return 1;
+}
+
+int mm_read_triplets_int_mmap(const char *path, triplet_t **out_t, int *out_rows, int *out_cols, int *out_nnz, mm_stats_t *stats) {
+    void *t;
+    if (!mm_read_triplets_mmap(path, sizeof(triplet_t), store_triplet_i, &t, out_rows, out_cols, out_nnz, stats))
+		return 0;
+    *out_t = (triplet_t *)t;
+    return 1;
+}
+
+/* ---- streaming .mtx -> CRS/CCS ---- */
+
+//by_col = 0 builds CRS (ptr over rows, idx = columns), 1 builds CCS
+//half = 1 only takes (skew-)symmetric files and keeps them folded into j <= i instead of
+//mirroring, out_sym (can be NULL) gets the header's 0 / 1 symmetric / 2 skew
+static int mm_stream_compressed(const char *path, int by_col, int half, int *out_sym, int *out_rows, int *out_cols,
+                                int *out_nnz, double **out_vals, int **out_idx, int **out_ptr, mm_stats_t *stats) {
+    long long t0 = now_ns();
+
+    mm_map_t m;
+    if (!mm_map_file(path, &m)) return 0;
+
+    mm_header_t h;
+    if (!mm_parse_header(m.base, m.base + m.size, &h)) { mm_unmap_file(&m); return 0; }
+    if (half && (!h.symmetric || h.n_rows != h.n_cols)) { mm_unmap_file(&m); return 0; }
+
+    int n_keys = by_col ? h.n_cols : h.n_rows;
+    int *ptr = (int *)calloc((size_t)n_keys + 1, sizeof(int));
+    if (!ptr) { mm_unmap_file(&m); return 0; }
+
+    //pass 1: histogram
+    const char *p = h.body;
+    long long total = 0;
+    for (int k = 0; k < h.nnz; k++) {
+        int i = 0, j = 0;
+        double v = 1.0;
+        if (mm_next_entry(&p, h.end, h.is_pattern, &i, &j, &v) != 1) { free(ptr); mm_unmap_file(&m); return 0; }
+
+        i--; j--;
+        if (i < 0 || i >= h.n_rows || j < 0 || j >= h.n_cols) { free(ptr); mm_unmap_file(&m); return 0; }
+        if (half && i < j) { int tmp = i; i = j; j = tmp; }
+
+        ptr[(by_col ? j : i) + 1]++;
+        total++;
+        if (h.symmetric && !half && i != j) {
+            ptr[(by_col ? i : j) + 1]++;
+            total++;
+        }
+    }
+    if (total > INT_MAX) { free(ptr); mm_unmap_file(&m); return 0; }
+
+    for (int r = 0; r < n_keys; r++)
+		ptr[r + 1] += ptr[r];
+
+    double *vals = (double *)malloc((size_t)(total ? total : 1) * sizeof(double));
+    int *idx = (int *)malloc((size_t)(total ? total : 1) * sizeof(int));
+    if (!vals || !idx) {
+        free(vals); free(idx); free(ptr);
+        mm_unmap_file(&m);
+        return 0;
+    }
+
+    //pass 2: scatter using ptr[r] as the cursor of row r, so no separate next array
+    p = h.body;
+    for (int k = 0; k < h.nnz; k++) {
+        int i = 0, j = 0;
+        double v = 1.0;
+        mm_next_entry(&p, h.end, h.is_pattern, &i, &j, &v);
+        i--; j--;
+        //some writers store the upper triangle, fold it down
+        if (half && i < j) {
+            int tmp = i; i = j; j = tmp;
+            if (h.symmetric == 2) v = -v;
+        }
+
+        int pos = ptr[by_col ? j : i]++;
+        vals[pos] = v;
+        idx[pos] = by_col ? i : j;
+
+        if (h.symmetric && !half && i != j) {
+            pos = ptr[by_col ? i : j]++;
+            vals[pos] = (h.symmetric == 2) ? -v : v;
+            idx[pos] = by_col ? j : i;
+        }
+    }
+
+    //every cursor now sits on the start of the next row, shift back by one
+    for (int r = n_keys; r > 0; r--)
+		ptr[r] = ptr[r - 1];
+    ptr[0] = 0;
+
+    long long peak = ((long long)n_keys + 1) * (long long)sizeof(int) +
+                     total * (long long)(sizeof(double) + sizeof(int));
+    mm_fill_stats(stats, &m, t0, 1, peak);
+    mm_unmap_file(&m);
+
+    if (out_sym) *out_sym = h.symmetric;
+    *out_rows = h.n_rows;
+    *out_cols = h.n_cols;
+    *out_nnz = (int)total;
+    *out_vals = vals;
+    *out_idx = idx;
+    *out_ptr = ptr;
+    return 1;
+}
+
+int mm_build_crs_double_stream(const char *path, crs_d_t *out, mm_stats_t *stats) {
+    crs_d_t a;
+    if (!mm_stream_compressed(path, 0, 0, NULL, &a.n_rows, &a.n_cols, &a.nnz, &a.values, &a.col_idx, &a.row_ptr, stats))
+		return 0;
+    *out = a;
+    return 1;
+}
+
+int mm_build_ccs_double_stream(const char *path, ccs_d_t *out, mm_stats_t *stats) {
+    ccs_d_t a;
+    if (!mm_stream_compressed(path, 1, 0, NULL, &a.n_rows, &a.n_cols, &a.nnz, &a.values, &a.row_idx, &a.col_ptr, stats))
+		return 0;
+    *out = a;
+    return 1;
+}
+
+int mm_build_crs_sym_double_stream(const char *path, crs_sym_d_t *out, mm_stats_t *stats) {
+    crs_sym_d_t a;
+    int n_cols, sym;
+    if (!mm_stream_compressed(path, 0, 1, &sym, &a.n, &n_cols, &a.nnz, &a.values, &a.col_idx, &a.row_ptr, stats))
+		return 0;
+
+    a.skew = (sym == 2);
+    a.nnz_full = 0;
+    for (int i = 0; i < a.n; i++)
+        for (int k = a.row_ptr[i]; k < a.row_ptr[i + 1]; k++)
+			a.nnz_full += (a.col_idx[k] == i) ? 1 : 2;
+    *out = a;
+    return 1;
+}
+
+int mm_write_crs_double(const char *path, const crs_d_t *a, const char *comment) {
+    FILE *f = fopen(path, "w");
+    if (!f) return 0;
+    setvbuf(f, NULL, _IOFBF, 1 << 20);
+
+    fprintf(f, "%%%%MatrixMarket matrix coordinate real general\n");
+    if (comment) fprintf(f, "%% %s\n", comment);
+    fprintf(f, "%d %d %d\n", a->n_rows, a->n_cols, a->nnz);
+    for (int i = 0; i < a->n_rows; i++)
+        for (int k = a->row_ptr[i]; k < a->row_ptr[i + 1]; k++)
+			fprintf(f, "%d %d %.17g\n", i + 1, a->col_idx[k] + 1, a->values[k]);
+
+    int ok = !ferror(f);
+    if (fclose(f) != 0) ok = 0;
+    return ok;
+}
+
+int mm_write_crs_sym_double(const char *path, const crs_sym_d_t *a, int upper, const char *comment) {
+    //the spec leaves the diagonal out of skew-symmetric files
+    if (a->skew) {
+        for (int i = 0; i < a->n; i++)
+            for (int k = a->row_ptr[i]; k < a->row_ptr[i + 1]; k++)
+				if (a->col_idx[k] == i) return 0;
+    }
+
+    FILE *f = fopen(path, "w");
+    if (!f) return 0;
+    setvbuf(f, NULL, _IOFBF, 1 << 20);
+
+    fprintf(f, "%%%%MatrixMarket matrix coordinate real %s\n", a->skew ? "skew-symmetric" : "symmetric");
+    if (comment) fprintf(f, "%% %s\n", comment);
+    fprintf(f, "%d %d %d\n", a->n, a->n, a->nnz);
+    //upper = 1 writes a_ji = +-a_ij with the indices swapped, like writers that keep the upper triangle
+    double sign = (upper && a->skew) ? -1.0 : 1.0;
+    for (int i = 0; i < a->n; i++) {
+        for (int k = a->row_ptr[i]; k < a->row_ptr[i + 1]; k++) {
+            int j = a->col_idx[k];
+            double v = (j == i) ? a->values[k] : sign * a->values[k];
+            if (upper) fprintf(f, "%d %d %.17g\n", j + 1, i + 1, v);
+            else fprintf(f, "%d %d %.17g\n", i + 1, j + 1, v);
+        }
+    }
+
+    int ok = !ferror(f);
+    if (fclose(f) != 0) ok = 0;
+    return ok;
+}
@@ -0,0 +1,197 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <omp.h>
+
+#include "perf_counters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#define HAVE_PERF_EVENTS 1
+#else
+#define HAVE_PERF_EVENTS 0
+#endif
+
+static const char *names[PC_N] = { "cycles", "instructions", "branch_misses", "l1d_misses", "llc_misses",
+                                   "dtlb_misses" };
+
+//group of each event, the first event of a group that opens becomes its leader
+static const int group_of[PC_N] = { 0, 0, 0, 1, 1, 1 };
+
+const char *perf_counter_name(int e) {
+    return (e >= 0 && e < PC_N) ? names[e] : "?";
+}
+
+#if HAVE_PERF_EVENTS
+
+static void event_attr(int e, struct perf_event_attr *a) {
+    memset(a, 0, sizeof(*a));
+    a->size = sizeof(*a);
+    a->disabled = 1;
+    a->exclude_kernel = 1;
+    a->exclude_hv = 1;
+    a->read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    const uint64_t rd_miss = ((uint64_t)PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                             ((uint64_t)PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    switch (e) {
+    case PC_CYCLES:      a->type = PERF_TYPE_HARDWARE; a->config = PERF_COUNT_HW_CPU_CYCLES; break;
+    case PC_INSTR:       a->type = PERF_TYPE_HARDWARE; a->config = PERF_COUNT_HW_INSTRUCTIONS; break;
+    case PC_BRANCH_MISS: a->type = PERF_TYPE_HARDWARE; a->config = PERF_COUNT_HW_BRANCH_MISSES; break;
+    case PC_L1D_MISS:    a->type = PERF_TYPE_HW_CACHE; a->config = PERF_COUNT_HW_CACHE_L1D | rd_miss; break;
+    case PC_LLC_MISS:    a->type = PERF_TYPE_HW_CACHE; a->config = PERF_COUNT_HW_CACHE_LL | rd_miss; break;
+    case PC_DTLB_MISS:   a->type = PERF_TYPE_HW_CACHE; a->config = PERF_COUNT_HW_CACHE_DTLB | rd_miss; break;
+    }
+}
+
+//opens the calling thread's set, returns how many events it got
+static int open_thread(int fd[PC_N]) {
+    int leader[2] = { -1, -1 };
+    int n = 0;
+    for (int e = 0; e < PC_N; e++) {
+        struct perf_event_attr a;
+        event_attr(e, &a);
+        int g = group_of[e];
+        fd[e] = (int)syscall(SYS_perf_event_open, &a, 0, -1, leader[g], 0);
+        if (fd[e] < 0) {
+            fd[e] = -1;
+            continue;
+        }
+        if (leader[g] < 0) leader[g] = fd[e];
+        n++;
+    }
+    return n;
+}
+
+static int is_leader(const int fd[PC_N], int e) {
+    for (int k = 0; k < e; k++)
+		if (group_of[k] == group_of[e] && fd[k] >= 0) return 0;
+    return fd[e] >= 0;
+}
+
+//an event only counts when every thread of the team opened it, otherwise the sum would be short
+static int all_have(const perf_team_t *t, int e) {
+    if (t->nthreads <= 0) return 0;
+    for (int i = 0; i < t->nthreads; i++)
+		if (t->fd[i][e] < 0) return 0;
+    return 1;
+}
+
+static void group_ioctl(perf_team_t *t, unsigned long req) {
+    for (int i = 0; i < t->nthreads; i++)
+        for (int e = 0; e < PC_N; e++)
+			if (is_leader(t->fd[i], e)) ioctl(t->fd[i][e], req, PERF_IOC_FLAG_GROUP);
+}
+
+int perf_team_open(perf_team_t *t, int nthreads) {
+    t->nthreads = 0;
+    t->fd = NULL;
+    if (nthreads < 1) nthreads = 1;
+
+    int (*fd)[PC_N] = (int (*)[PC_N])malloc((size_t)nthreads * sizeof(*fd));
+    if (!fd) return 0;
+    for (int i = 0; i < nthreads; i++)
+        for (int e = 0; e < PC_N; e++)
+			fd[i][e] = -1;
+
+    //a thread can only open counters for itself, so the team is whatever the runtime delivers
+    //(thread limit, dynamic teams). the kernels ask for the same size and spread their work over
+    //the team they get, so that is also every thread there is to count
+    int team = nthreads;
+    #pragma omp parallel num_threads(nthreads)
+    {
+        open_thread(fd[omp_get_thread_num()]);
+        #pragma omp single
+        team = omp_get_num_threads();
+    }
+
+    t->nthreads = team;
+    t->fd = fd;
+    int got = 0;
+    for (int e = 0; e < PC_N; e++)
+		got += all_have(t, e);
+    if (got == 0) {
+        free_perf_team(t);
+        return 0;
+    }
+    return got;
+}
+
+void perf_team_start(perf_team_t *t) {
+    group_ioctl(t, PERF_EVENT_IOC_RESET);
+    group_ioctl(t, PERF_EVENT_IOC_ENABLE);
+}
+
+void perf_team_stop(perf_team_t *t, perf_counts_t *out) {
+    group_ioctl(t, PERF_EVENT_IOC_DISABLE);
+
+    for (int e = 0; e < PC_N; e++) {
+        out->v[e] = 0.0;
+        out->have[e] = all_have(t, e);
+    }
+
+    //group read: nr, time_enabled, time_running, then one value per member in open order
+    for (int i = 0; i < t->nthreads; i++) {
+        for (int e = 0; e < PC_N; e++) {
+            if (!is_leader(t->fd[i], e)) continue;
+            uint64_t buf[3 + PC_N];
+            ssize_t r = read(t->fd[i][e], buf, sizeof(buf));
+            if (r < (ssize_t)(3 * sizeof(uint64_t))) continue;
+
+            double scale = 1.0;
+            if (buf[2] == 0) continue;    //never scheduled, nothing to scale
+            if (buf[2] < buf[1]) scale = (double)buf[1] / (double)buf[2];
+
+            uint64_t k = 0;
+            for (int m = e; m < PC_N && k < buf[0]; m++) {
+                if (group_of[m] != group_of[e] || t->fd[i][m] < 0) continue;
+                if (out->have[m]) out->v[m] += (double)buf[3 + k] * scale;
+                k++;
+            }
+        }
+    }
+}
+
+void free_perf_team(perf_team_t *t) {
+    if (t->fd) {
+        for (int i = 0; i < t->nthreads; i++)
+            for (int e = 0; e < PC_N; e++)
+				if (t->fd[i][e] >= 0) close(t->fd[i][e]);
+    }
+    free(t->fd);
+    t->fd = NULL;
+    t->nthreads = 0;
+}
+
+#else
+
+int perf_team_open(perf_team_t *t, int nthreads) {
+    (void)nthreads;
+    t->nthreads = 0;
+    t->fd = NULL;
+    return 0;
+}
+
+void perf_team_start(perf_team_t *t) {
+    (void)t;
+}
+
+void perf_team_stop(perf_team_t *t, perf_counts_t *out) {
+    (void)t;
+    for (int e = 0; e < PC_N; e++) {
+        out->v[e] = 0.0;
+        out->have[e] = 0;
+    }
+}
+
+void free_perf_team(perf_team_t *t) {
+    t->fd = NULL;
+    t->nthreads = 0;
+}
+
+#endif
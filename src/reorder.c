@@ -0,0 +1,261 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "reorder.h"
+#include "formats.h"
+
+//pattern of A + A^T without the diagonal, duplicates removed
+typedef struct { int n; int *ptr, *adj; } graph_t;
+
+static void free_graph(graph_t *g) {
+    free(g->ptr);
+    free(g->adj);
+    g->ptr = NULL;
+    g->adj = NULL;
+}
+
+static int build_sym_graph(const crs_d_t *a, graph_t *g) {
+    int n = a->n_rows;
+    g->n = n;
+    g->ptr = (int *)calloc((size_t)n + 1, sizeof(int));
+    g->adj = (int *)malloc((size_t)a->nnz * 2 * sizeof(int) + 1);
+    int *stamp = (int *)malloc((size_t)n * sizeof(int) + 1);
+    if (!g->ptr || !g->adj || !stamp) {
+        free(stamp);
+        free_graph(g);
+        return 0;
+    }
+
+    //every off diagonal entry goes into both lists, compacted per node below
+    for (int i = 0; i < n; i++) {
+        for (int k = a->row_ptr[i]; k < a->row_ptr[i + 1]; k++) {
+            int j = a->col_idx[k];
+            if (j == i) continue;
+            g->ptr[i + 1]++;
+            g->ptr[j + 1]++;
+        }
+    }
+    for (int i = 0; i < n; i++)
+		g->ptr[i + 1] += g->ptr[i];
+
+    int *next = stamp;
+    for (int i = 0; i < n; i++) next[i] = g->ptr[i];
+    for (int i = 0; i < n; i++) {
+        for (int k = a->row_ptr[i]; k < a->row_ptr[i + 1]; k++) {
+            int j = a->col_idx[k];
+            if (j == i) continue;
+            g->adj[next[i]++] = j;
+            g->adj[next[j]++] = i;
+        }
+    }
+
+    for (int i = 0; i < n; i++) stamp[i] = -1;
+    int w = 0;
+    for (int i = 0; i < n; i++) {
+        int k0 = g->ptr[i], k1 = g->ptr[i + 1];
+        g->ptr[i] = w;
+        for (int k = k0; k < k1; k++) {
+            int j = g->adj[k];
+            if (stamp[j] == i) continue;
+            stamp[j] = i;
+            g->adj[w++] = j;
+        }
+    }
+    g->ptr[n] = w;
+
+    free(stamp);
+    return 1;
+}
+
+static int degree(const graph_t *g, int v) {
+    return g->ptr[v + 1] - g->ptr[v];
+}
+
+//level structure from start, queue gets the component in bfs order. level[] must be -1 for the
+//component on entry and is reset before returning. returns the number of nodes, *depth the
+//eccentricity and *last a min degree node of the last level
+static int bfs_levels(const graph_t *g, int start, int *level, int *queue, int *depth, int *last) {
+    int head = 0, tail = 0;
+    queue[tail++] = start;
+    level[start] = 0;
+    while (head < tail) {
+        int v = queue[head++];
+        for (int k = g->ptr[v]; k < g->ptr[v + 1]; k++) {
+            int u = g->adj[k];
+            if (level[u] < 0) {
+                level[u] = level[v] + 1;
+                queue[tail++] = u;
+            }
+        }
+    }
+
+    *depth = level[queue[tail - 1]];
+    *last = queue[tail - 1];
+    for (int q = tail - 1; q >= 0 && level[queue[q]] == *depth; q--)
+        if (degree(g, queue[q]) < degree(g, *last)) *last = queue[q];
+
+    for (int q = 0; q < tail; q++) level[queue[q]] = -1;
+    return tail;
+}
+
+//george-liu: hop to a min degree node of the deepest level until the depth stops growing
+static int pseudo_peripheral(const graph_t *g, int start, int *level, int *queue) {
+    int depth, last;
+    bfs_levels(g, start, level, queue, &depth, &last);
+    for (int it = 0; it < 8; it++) {
+        int d2, l2;
+        bfs_levels(g, last, level, queue, &d2, &l2);
+        if (d2 <= depth) break;
+        start = last;
+        depth = d2;
+        last = l2;
+    }
+    return start;
+}
+
+int rcm_order(const crs_d_t *a, int *perm) {
+    if (a->n_rows != a->n_cols) return 0;
+
+    graph_t g;
+    if (!build_sym_graph(a, &g)) return 0;
+
+    int n = g.n;
+    int *level = (int *)malloc((size_t)n * sizeof(int) + 1);
+    int *queue = (int *)malloc((size_t)n * sizeof(int) + 1);
+    char *done = (char *)calloc((size_t)n + 1, 1);
+    if (!level || !queue || !done) {
+        free(level); free(queue); free(done);
+        free_graph(&g);
+        return 0;
+    }
+    for (int i = 0; i < n; i++) level[i] = -1;
+
+    //cuthill-mckee order goes straight into perm, reversed at the end
+    int head = 0, tail = 0;
+    for (int s = 0; s < n; s++) {
+        if (done[s]) continue;
+
+        int root = pseudo_peripheral(&g, s, level, queue);
+        perm[tail++] = root;
+        done[root] = 1;
+        while (head < tail) {
+            int v = perm[head++];
+            int first = tail;
+            for (int k = g.ptr[v]; k < g.ptr[v + 1]; k++) {
+                int u = g.adj[k];
+                if (done[u]) continue;
+                done[u] = 1;
+                perm[tail++] = u;
+            }
+
+            //new neighbours by increasing degree, insertion sort since the runs are short
+            for (int q = first + 1; q < tail; q++) {
+                int u = perm[q];
+                int du = degree(&g, u);
+                int r = q - 1;
+                while (r >= first && degree(&g, perm[r]) > du) {
+                    perm[r + 1] = perm[r];
+                    r--;
+                }
+                perm[r + 1] = u;
+            }
+        }
+    }
+
+    for (int i = 0; i < n / 2; i++) {
+        int tmp = perm[i];
+        perm[i] = perm[n - 1 - i];
+        perm[n - 1 - i] = tmp;
+    }
+
+    free(level);
+    free(queue);
+    free(done);
+    free_graph(&g);
+    return 1;
+}
+
+int crs_permute_sym(const crs_d_t *a, const int *perm, crs_d_t *out) {
+    int n = a->n_rows;
+    if (n != a->n_cols) return 0;
+
+    int *iperm = (int *)malloc((size_t)n * sizeof(int) + 1);
+    crs_d_t b;
+    b.n_rows = n;
+    b.n_cols = n;
+    b.nnz = a->nnz;
+    b.values = (double *)malloc((size_t)a->nnz * sizeof(double) + 1);
+    b.col_idx = (int *)malloc((size_t)a->nnz * sizeof(int) + 1);
+    b.row_ptr = (int *)malloc((size_t)(n + 1) * sizeof(int));
+    if (!iperm || !b.values || !b.col_idx || !b.row_ptr) {
+        free(iperm);
+        free_crs_d(&b);
+        return 0;
+    }
+    for (int i = 0; i < n; i++) iperm[perm[i]] = i;
+
+    b.row_ptr[0] = 0;
+    for (int i = 0; i < n; i++) {
+        int src = perm[i];
+        int w = b.row_ptr[i];
+        for (int k = a->row_ptr[src]; k < a->row_ptr[src + 1]; k++, w++) {
+            b.values[w] = a->values[k];
+            b.col_idx[w] = iperm[a->col_idx[k]];
+        }
+        b.row_ptr[i + 1] = w;
+    }
+    free(iperm);
+
+    //two counting transposes sort the columns of every row
+    ccs_d_t t;
+    if (!build_ccs_from_crs_double(&b, &t)) {
+        free_crs_d(&b);
+        return 0;
+    }
+    free_crs_d(&b);
+
+    crs_d_t tt = { t.n_cols, t.n_rows, t.nnz, t.values, t.row_idx, t.col_ptr };
+    ccs_d_t back;
+    int ok = build_ccs_from_crs_double(&tt, &back);
+    free_ccs_d(&t);
+    if (!ok) return 0;
+
+    out->n_rows = n;
+    out->n_cols = n;
+    out->nnz = back.nnz;
+    out->values = back.values;
+    out->col_idx = back.row_idx;
+    out->row_ptr = back.col_ptr;
+    return 1;
+}
+
+void permute_vec(const int *perm, int n, const double *x, double *xp) {
+    for (int i = 0; i < n; i++) xp[i] = x[perm[i]];
+}
+
+void unpermute_vec(const int *perm, int n, const double *yp, double *y) {
+    for (int i = 0; i < n; i++) y[perm[i]] = yp[i];
+}
+
+int crs_bandwidth(const crs_d_t *a) {
+    int bw = 0;
+    for (int i = 0; i < a->n_rows; i++) {
+        for (int k = a->row_ptr[i]; k < a->row_ptr[i + 1]; k++) {
+            int d = a->col_idx[k] - i;
+            if (d < 0) d = -d;
+            if (d > bw) bw = d;
+        }
+    }
+    return bw;
+}
+
+long long crs_profile(const crs_d_t *a) {
+    long long p = 0;
+    for (int i = 0; i < a->n_rows; i++) {
+        int lo = i;
+        for (int k = a->row_ptr[i]; k < a->row_ptr[i + 1]; k++)
+            if (a->col_idx[k] < lo) lo = a->col_idx[k];
+        p += i - lo;
+    }
+    return p;
+}
@@ -0,0 +1,250 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "sparse_bin.h"
+
+#define SBIN_ALIGN 64
+#define SBIN_ENDIAN 0x01020304u
+
+enum {
+    SEC_CRS_VALUES, SEC_CRS_COL_IDX, SEC_CRS_ROW_PTR,
+    SEC_CCS_VALUES, SEC_CCS_ROW_IDX, SEC_CCS_COL_PTR,
+    SEC_TJDS_TJD, SEC_TJDS_ROW_IDX, SEC_TJDS_PERM, SEC_TJDS_TJD_PTR,
+    SEC_COUNT
+};
+
+typedef struct {
+    char magic[8];
+    uint32_t version, endian;
+    uint32_t flags, reserved;
+    int32_t n_rows, n_cols, nnz, num_tjd;
+    int64_t src_size, src_mtime_ns;
+    uint64_t off[SEC_COUNT];
+    uint64_t len[SEC_COUNT];
+} sbin_header_t;
+
+static const char sbin_magic[8] = { 'S', 'P', 'M', 'X', 'B', 'I', 'N', '\0' };
+
+static uint64_t align_up(uint64_t x) {
+    return (x + SBIN_ALIGN - 1) & ~(uint64_t)(SBIN_ALIGN - 1);
+}
+
+static int src_stamp(const char *src_path, int64_t *size, int64_t *mtime_ns) {
+    struct stat st;
+    if (!src_path || stat(src_path, &st) != 0) return 0;
+    *size = (int64_t)st.st_size;
+    *mtime_ns = (int64_t)st.st_mtim.tv_sec * 1000000000LL + (int64_t)st.st_mtim.tv_nsec;
+    return 1;
+}
+
+static int write_padded(FILE *f, const void *p, uint64_t len, uint64_t *pos) {
+    static const char zeros[SBIN_ALIGN] = { 0 };
+    if (len && fwrite(p, 1, (size_t)len, f) != (size_t)len) return 0;
+    *pos += len;
+    uint64_t pad = align_up(*pos) - *pos;
+    if (pad && fwrite(zeros, 1, (size_t)pad, f) != (size_t)pad) return 0;
+    *pos += pad;
+    return 1;
+}
+
+int sbin_write(const char *path, const crs_d_t *crs, const ccs_d_t *ccs, const tjds_d_t *tjds, const char *src_path) {
+    sbin_header_t h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, sbin_magic, sizeof(h.magic));
+    h.version = SBIN_VERSION;
+    h.endian = SBIN_ENDIAN;
+
+    const void *src[SEC_COUNT] = { 0 };
+
+    if (crs) {
+        h.flags |= SBIN_HAS_CRS;
+        src[SEC_CRS_VALUES] = crs->values;   h.len[SEC_CRS_VALUES] = (uint64_t)crs->nnz * sizeof(double);
+        src[SEC_CRS_COL_IDX] = crs->col_idx; h.len[SEC_CRS_COL_IDX] = (uint64_t)crs->nnz * sizeof(int);
+        src[SEC_CRS_ROW_PTR] = crs->row_ptr; h.len[SEC_CRS_ROW_PTR] = (uint64_t)(crs->n_rows + 1) * sizeof(int);
+    }
+    if (ccs) {
+        h.flags |= SBIN_HAS_CCS;
+        src[SEC_CCS_VALUES] = ccs->values;   h.len[SEC_CCS_VALUES] = (uint64_t)ccs->nnz * sizeof(double);
+        src[SEC_CCS_ROW_IDX] = ccs->row_idx; h.len[SEC_CCS_ROW_IDX] = (uint64_t)ccs->nnz * sizeof(int);
+        src[SEC_CCS_COL_PTR] = ccs->col_ptr; h.len[SEC_CCS_COL_PTR] = (uint64_t)(ccs->n_cols + 1) * sizeof(int);
+    }
+    if (tjds) {
+        h.flags |= SBIN_HAS_TJDS;
+        h.num_tjd = tjds->num_tjd;
+        src[SEC_TJDS_TJD] = tjds->tjd;          h.len[SEC_TJDS_TJD] = (uint64_t)tjds->nnz * sizeof(double);
+        src[SEC_TJDS_ROW_IDX] = tjds->row_idx;  h.len[SEC_TJDS_ROW_IDX] = (uint64_t)tjds->nnz * sizeof(int);
+        src[SEC_TJDS_PERM] = tjds->perm;        h.len[SEC_TJDS_PERM] = (uint64_t)tjds->n_cols * sizeof(int);
+        src[SEC_TJDS_TJD_PTR] = tjds->tjd_ptr;  h.len[SEC_TJDS_TJD_PTR] = (uint64_t)(tjds->num_tjd + 1) * sizeof(int);
+    }
+    if (!h.flags) return 0;
+
+    //all sections have to describe the same matrix
+    int n_rows = crs ? crs->n_rows : (ccs ? ccs->n_rows : tjds->n_rows);
+    int n_cols = crs ? crs->n_cols : (ccs ? ccs->n_cols : tjds->n_cols);
+    int nnz = crs ? crs->nnz : (ccs ? ccs->nnz : tjds->nnz);
+    if ((ccs && (ccs->n_rows != n_rows || ccs->n_cols != n_cols || ccs->nnz != nnz)) ||
+        (tjds && (tjds->n_rows != n_rows || tjds->n_cols != n_cols || tjds->nnz != nnz)))
+		return 0;
+
+    h.n_rows = n_rows;
+    h.n_cols = n_cols;
+    h.nnz = nnz;
+    src_stamp(src_path, &h.src_size, &h.src_mtime_ns);
+
+    uint64_t pos = align_up(sizeof(h));
+    for (int s = 0; s < SEC_COUNT; s++) {
+        if (!src[s]) continue;
+        h.off[s] = pos;
+        pos = align_up(pos + h.len[s]);
+    }
+
+    //write next to the target and rename so a reader never maps a half written file
+    size_t plen = strlen(path);
+    char *tmp = (char *)malloc(plen + 16);
+    if (!tmp) return 0;
+    snprintf(tmp, plen + 16, "%s.tmp%ld", path, (long)getpid());
+
+    FILE *f = fopen(tmp, "wb");
+    if (!f) { free(tmp); return 0; }
+
+    pos = 0;
+    int ok = write_padded(f, &h, sizeof(h), &pos);
+    for (int s = 0; ok && s < SEC_COUNT; s++) {
+        if (!src[s]) continue;
+        ok = (pos == h.off[s]) && write_padded(f, src[s], h.len[s], &pos);
+    }
+
+    if (fclose(f) != 0) ok = 0;
+    if (ok && rename(tmp, path) != 0) ok = 0;
+    if (!ok) remove(tmp);
+
+    free(tmp);
+    return ok;
+}
+
+//ptr[0] == 0, ptr[n] == nnz and never decreasing, so the kernels stay inside the arrays
+static int ptr_ok(const int *ptr, int n, int nnz) {
+    if (ptr[0] != 0 || ptr[n] != nnz) return 0;
+    for (int i = 0; i < n; i++)
+		if (ptr[i] > ptr[i + 1]) return 0;
+    return 1;
+}
+
+static int idx_ok(const int *idx, int len, int dim) {
+    for (int k = 0; k < len; k++)
+		if (idx[k] < 0 || idx[k] >= dim) return 0;
+    return 1;
+}
+
+//one pass over the index arrays at map time, a damaged file is rejected instead of read out of bounds
+static int sections_ok(const char *b, const sbin_header_t *h) {
+    if (h->flags & SBIN_HAS_CRS) {
+        if (!ptr_ok((const int *)(b + h->off[SEC_CRS_ROW_PTR]), h->n_rows, h->nnz) ||
+            !idx_ok((const int *)(b + h->off[SEC_CRS_COL_IDX]), h->nnz, h->n_cols))
+            return 0;
+    }
+    if (h->flags & SBIN_HAS_CCS) {
+        if (!ptr_ok((const int *)(b + h->off[SEC_CCS_COL_PTR]), h->n_cols, h->nnz) ||
+            !idx_ok((const int *)(b + h->off[SEC_CCS_ROW_IDX]), h->nnz, h->n_rows))
+            return 0;
+    }
+    if (h->flags & SBIN_HAS_TJDS) {
+        const int *tjd_ptr = (const int *)(b + h->off[SEC_TJDS_TJD_PTR]);
+        if (!ptr_ok(tjd_ptr, h->num_tjd, h->nnz) ||
+            !idx_ok((const int *)(b + h->off[SEC_TJDS_ROW_IDX]), h->nnz, h->n_rows) ||
+            !idx_ok((const int *)(b + h->off[SEC_TJDS_PERM]), h->n_cols, h->n_cols))
+            return 0;
+        //entry k of a diagonal reads x[perm[k]], so no diagonal may be longer than perm
+        for (int d = 0; d < h->num_tjd; d++)
+			if (tjd_ptr[d + 1] - tjd_ptr[d] > h->n_cols) return 0;
+    }
+    return 1;
+}
+
+int sbin_map(const char *path, const char *src_path, sbin_map_t *out) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(sbin_header_t)) { close(fd); return 0; }
+    size_t size = (size_t)st.st_size;
+
+    //shared so every process mapping the same file reads the same page cache pages
+    void *base = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return 0;
+
+    const sbin_header_t *h = (const sbin_header_t *)base;
+    int ok = memcmp(h->magic, sbin_magic, sizeof(h->magic)) == 0 &&
+             h->version == SBIN_VERSION && h->endian == SBIN_ENDIAN &&
+             h->n_rows >= 0 && h->n_cols >= 0 && h->nnz >= 0 && h->num_tjd >= 0;
+
+    int64_t src_size = 0, src_mtime_ns = 0;
+    if (ok && src_stamp(src_path, &src_size, &src_mtime_ns))
+		ok = (h->src_size == src_size && h->src_mtime_ns == src_mtime_ns);
+
+    uint64_t want[SEC_COUNT] = {
+        (uint64_t)h->nnz * sizeof(double), (uint64_t)h->nnz * sizeof(int), (uint64_t)(h->n_rows + 1) * sizeof(int),
+        (uint64_t)h->nnz * sizeof(double), (uint64_t)h->nnz * sizeof(int), (uint64_t)(h->n_cols + 1) * sizeof(int),
+        (uint64_t)h->nnz * sizeof(double), (uint64_t)h->nnz * sizeof(int), (uint64_t)h->n_cols * sizeof(int),
+        (uint64_t)(h->num_tjd + 1) * sizeof(int)
+    };
+    int sec_flag[SEC_COUNT] = {
+        SBIN_HAS_CRS, SBIN_HAS_CRS, SBIN_HAS_CRS,
+        SBIN_HAS_CCS, SBIN_HAS_CCS, SBIN_HAS_CCS,
+        SBIN_HAS_TJDS, SBIN_HAS_TJDS, SBIN_HAS_TJDS, SBIN_HAS_TJDS
+    };
+
+    for (int s = 0; ok && s < SEC_COUNT; s++) {
+        if (!(h->flags & (uint32_t)sec_flag[s])) continue;
+        ok = h->len[s] == want[s] && h->off[s] % SBIN_ALIGN == 0 &&
+             h->off[s] >= sizeof(sbin_header_t) && h->off[s] + h->len[s] <= size;
+    }
+    if (ok) ok = (h->flags & (SBIN_HAS_CRS | SBIN_HAS_CCS | SBIN_HAS_TJDS)) && sections_ok((const char *)base, h);
+    if (!ok) {
+        munmap(base, size);
+        return 0;
+    }
+
+    char *b = (char *)base;
+    memset(out, 0, sizeof(*out));
+    out->base = base;
+    out->size = size;
+    out->flags = (int)h->flags;
+
+    if (h->flags & SBIN_HAS_CRS) {
+        out->crs = (crs_d_t){ .n_rows = h->n_rows, .n_cols = h->n_cols, .nnz = h->nnz,
+            .values = (double *)(b + h->off[SEC_CRS_VALUES]),
+            .col_idx = (int *)(b + h->off[SEC_CRS_COL_IDX]),
+            .row_ptr = (int *)(b + h->off[SEC_CRS_ROW_PTR]) };
+    }
+    if (h->flags & SBIN_HAS_CCS) {
+        out->ccs = (ccs_d_t){ .n_rows = h->n_rows, .n_cols = h->n_cols, .nnz = h->nnz,
+            .values = (double *)(b + h->off[SEC_CCS_VALUES]),
+            .row_idx = (int *)(b + h->off[SEC_CCS_ROW_IDX]),
+            .col_ptr = (int *)(b + h->off[SEC_CCS_COL_PTR]) };
+    }
+    if (h->flags & SBIN_HAS_TJDS) {
+        out->tjds = (tjds_d_t){ .n_rows = h->n_rows, .n_cols = h->n_cols, .nnz = h->nnz, .num_tjd = h->num_tjd,
+            .tjd = (double *)(b + h->off[SEC_TJDS_TJD]),
+            .row_idx = (int *)(b + h->off[SEC_TJDS_ROW_IDX]),
+            .perm = (int *)(b + h->off[SEC_TJDS_PERM]),
+            .tjd_ptr = (int *)(b + h->off[SEC_TJDS_TJD_PTR]) };
+    }
+
+    return 1;
+}
+
+void sbin_unmap(sbin_map_t *m) {
+    if (!m || !m->base) return;
+    munmap(m->base, m->size);
+    memset(m, 0, sizeof(*m));
+}
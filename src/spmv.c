@@ -1,6 +1,8 @@
 #include <stdlib.h>
+#include <omp.h>
 
 #include "spmv.h"
+#include "util.h"
 
 void dense_spmv(const int *a, int n_rows, int n_cols, const int *x, int *y) {
     for (int i = 0; i < n_rows; i++) {
@@ -84,6 +86,130 @@ void crs_spmv_double(const crs_d_t *a, const double *x, double *y) {
     }
 }
 
+void ccs_spmv_double(const ccs_d_t *a, const double *x, double *y) {
+    for (int i = 0; i < a->n_rows; i++) y[i] = 0.0;
+
+    for (int j = 0; j < a->n_cols; j++) {
+        for (int k = a->col_ptr[j]; k < a->col_ptr[j + 1]; k++) {
+            y[a->row_idx[k]] += a->values[k] * x[j];
+        }
+    }
+}
+
+//walks a chunk column by column, the C partial sums live in sum[] (C <= 16)
+void sell_spmv_double(const sell_d_t *a, const double *x, double *y) {
+    int C = a->C;
+    double sum[16];
+
+    for (int ch = 0; ch < a->n_chunks; ch++) {
+        int base = a->chunk_ptr[ch];
+        for (int l = 0; l < C; l++) sum[l] = 0.0;
+
+        for (int j = 0; j < a->chunk_len[ch]; j++) {
+            int off = base + j * C;
+            for (int l = 0; l < C; l++)
+				sum[l] += a->values[off + l] * x[a->col_idx[off + l]];
+        }
+
+        for (int l = 0; l < C; l++) {
+            int r = a->perm[ch * C + l];
+            if (r >= 0) y[r] = sum[l];
+        }
+    }
+}
+
+//slot column j is contiguous over rows, so the inner loop is unit stride in y/values/col_idx
+void ell_spmv_double(const ell_d_t *a, const double *x, double *y) {
+    int n = a->n_rows;
+    for (int i = 0; i < n; i++) y[i] = 0.0;
+
+    for (int j = 0; j < a->width; j++) {
+        const double *v = a->values + (size_t)j * (size_t)n;
+        const int *c = a->col_idx + (size_t)j * (size_t)n;
+        for (int i = 0; i < n; i++)
+			y[i] += v[i] * x[c[i]];
+    }
+}
+
+void hyb_spmv_double(const hyb_d_t *a, const double *x, double *y) {
+    ell_spmv_double(&a->ell, x, y);
+
+    for (int k = 0; k < a->coo_nnz; k++)
+		y[a->coo_row[k]] += a->coo_val[k] * x[a->coo_col[k]];
+}
+
+//one kernel per block shape with R and C as constants, so the block loops unroll completely
+//and the R partial sums stay in registers. full block rows only, the ragged last one is below
+#define BCSR_KERNEL(R, C)                                                               \
+static void bcsr_kernel_##R##x##C(const bcsr_d_t *a, const double *x, double *y, int n_full) { \
+    for (int br = 0; br < n_full; br++) {                                               \
+        double sum[R] = { 0.0 };                                                        \
+        for (int k = a->brow_ptr[br]; k < a->brow_ptr[br + 1]; k++) {                   \
+            const double *v = a->values + (size_t)k * (R * C);                          \
+            const double *xb = x + a->bcol_idx[k];                                      \
+            _Pragma("GCC unroll 4")                                                     \
+            for (int i = 0; i < R; i++) {                                               \
+                _Pragma("GCC unroll 4")                                                 \
+                for (int j = 0; j < C; j++)                                             \
+					sum[i] += v[i * C + j] * xb[j];                                     \
+            }                                                                           \
+        }                                                                               \
+        for (int i = 0; i < R; i++) y[br * R + i] = sum[i];                             \
+    }                                                                                   \
+}
+
+BCSR_KERNEL(1, 1) BCSR_KERNEL(1, 2) BCSR_KERNEL(1, 3) BCSR_KERNEL(1, 4)
+BCSR_KERNEL(2, 1) BCSR_KERNEL(2, 2) BCSR_KERNEL(2, 3) BCSR_KERNEL(2, 4)
+BCSR_KERNEL(3, 1) BCSR_KERNEL(3, 2) BCSR_KERNEL(3, 3) BCSR_KERNEL(3, 4)
+BCSR_KERNEL(4, 1) BCSR_KERNEL(4, 2) BCSR_KERNEL(4, 3) BCSR_KERNEL(4, 4)
+
+typedef void (*bcsr_kernel_t)(const bcsr_d_t *, const double *, double *, int);
+
+static const bcsr_kernel_t bcsr_kernels[4][4] = {
+    { bcsr_kernel_1x1, bcsr_kernel_1x2, bcsr_kernel_1x3, bcsr_kernel_1x4 },
+    { bcsr_kernel_2x1, bcsr_kernel_2x2, bcsr_kernel_2x3, bcsr_kernel_2x4 },
+    { bcsr_kernel_3x1, bcsr_kernel_3x2, bcsr_kernel_3x3, bcsr_kernel_3x4 },
+    { bcsr_kernel_4x1, bcsr_kernel_4x2, bcsr_kernel_4x3, bcsr_kernel_4x4 },
+};
+
+void bcsr_spmv_double(const bcsr_d_t *a, const double *x, double *y) {
+    int r = a->r, c = a->c;
+    int n_full = a->n_rows / r;
+    bcsr_kernels[r - 1][c - 1](a, x, y, n_full);
+
+    //last block row when r does not divide n_rows, only its real rows get written
+    if (n_full < a->n_brows) {
+        double sum[4] = { 0.0 };
+        for (int k = a->brow_ptr[n_full]; k < a->brow_ptr[n_full + 1]; k++) {
+            const double *v = a->values + (size_t)k * r * c;
+            for (int i = 0; i < r; i++)
+                for (int j = 0; j < c; j++)
+					sum[i] += v[i * c + j] * x[a->bcol_idx[k] + j];
+        }
+        for (int i = 0; n_full * r + i < a->n_rows; i++) y[n_full * r + i] = sum[i];
+    }
+}
+
+//a row is walked one segment piece at a time so the base is loaded once per piece and the inner
+//loop is a plain gather like crs. escapes are added after all rows, in entry order
+void crs_delta_spmv_double(const crs_delta_d_t *a, const double *x, double *y) {
+    for (int i = 0; i < a->n_rows; i++) {
+        int k = a->row_ptr[i];
+        int k1 = a->row_ptr[i + 1];
+        double sum = 0.0;
+        while (k < k1) {
+            int s = k / CRS_DELTA_SEG;
+            int end = (s + 1) * CRS_DELTA_SEG < k1 ? (s + 1) * CRS_DELTA_SEG : k1;
+            const double *xb = x + a->base[s];
+            for (; k < end; k++)
+				sum += a->values[k] * xb[a->delta[k]];
+        }
+        y[i] = sum;
+    }
+    for (int e = 0; e < a->n_esc; e++)
+		y[a->esc_row[e]] += a->esc_val[e] * x[a->esc_col[e]];
+}
+
 void tjds_spmv_double(const tjds_d_t *a, const double *x, double *y) {
     for (int i = 0; i < a->n_rows; i++) y[i] = 0.0;
 
@@ -101,3 +227,800 @@ void tjds_spmv_double(const tjds_d_t *a, const double *x, double *y) {
     }
 }
 
+
+void crs_f_spmv_double(const crs_f_t *a, const double *x, double *y) {
+    for (int i = 0; i < a->n_rows; i++) {
+        double sum = 0.0;
+        for (int k = a->row_ptr[i]; k < a->row_ptr[i + 1]; k++)
+			sum += (double)a->values[k] * x[a->col_idx[k]];
+        y[i] = sum;
+    }
+}
+
+void crs_f_spmv_xf(const crs_f_t *a, const float *x, double *y) {
+    for (int i = 0; i < a->n_rows; i++) {
+        double sum = 0.0;
+        for (int k = a->row_ptr[i]; k < a->row_ptr[i + 1]; k++)
+			sum += (double)a->values[k] * (double)x[a->col_idx[k]];
+        y[i] = sum;
+    }
+}
+
+void tjds_f_spmv_double(const tjds_f_t *a, const double *x, double *y) {
+    for (int i = 0; i < a->n_rows; i++) y[i] = 0.0;
+
+    for (int d = 0; d < a->num_tjd; d++) {
+        int start = a->tjd_ptr[d];
+        int len = a->tjd_ptr[d + 1] - start;
+        for (int cidx = 0; cidx < len; cidx++)
+			y[a->row_idx[start + cidx]] += (double)a->tjd[start + cidx] * x[a->perm[cidx]];
+    }
+}
+
+void tjds_f_spmv_xf(const tjds_f_t *a, const float *x, double *y) {
+    for (int i = 0; i < a->n_rows; i++) y[i] = 0.0;
+
+    for (int d = 0; d < a->num_tjd; d++) {
+        int start = a->tjd_ptr[d];
+        int len = a->tjd_ptr[d + 1] - start;
+        for (int cidx = 0; cidx < len; cidx++)
+			y[a->row_idx[start + cidx]] += (double)a->tjd[start + cidx] * (double)x[a->perm[cidx]];
+    }
+}
+
+void crs_sym_spmv_double(const crs_sym_d_t *a, const double *x, double *y) {
+    double sign = a->skew ? -1.0 : 1.0;
+    for (int i = 0; i < a->n; i++) y[i] = 0.0;
+
+    for (int i = 0; i < a->n; i++) {
+        double sum = 0.0;
+        double sxi = sign * x[i];
+        for (int k = a->row_ptr[i]; k < a->row_ptr[i + 1]; k++) {
+            int j = a->col_idx[k];
+            sum += a->values[k] * x[j];
+            if (j != i) y[j] += a->values[k] * sxi;
+        }
+        y[i] += sum;
+    }
+}
+
+//K is a constant in each copy, so the j loops become straight vector code over a row of X
+#define CRS_SPMM_KERNEL(K)                                                              \
+static void crs_spmm_k##K(const crs_d_t *a, const double *restrict X, double *restrict Y) { \
+    for (int i = 0; i < a->n_rows; i++) {                                               \
+        double *restrict yr = Y + (size_t)i * K;                                        \
+        for (int j = 0; j < K; j++) yr[j] = 0.0;                                        \
+        for (int p = a->row_ptr[i]; p < a->row_ptr[i + 1]; p++) {                       \
+            double v = a->values[p];                                                    \
+            const double *restrict xr = X + (size_t)a->col_idx[p] * K;                  \
+            _Pragma("omp simd")                                                         \
+            for (int j = 0; j < K; j++) yr[j] += v * xr[j];                             \
+        }                                                                               \
+    }                                                                                   \
+}
+
+#define TJDS_SPMM_KERNEL(K)                                                             \
+static void tjds_spmm_k##K(const tjds_d_t *a, const double *restrict X, double *restrict Y) { \
+    for (size_t q = 0; q < (size_t)a->n_rows * K; q++) Y[q] = 0.0;                     \
+    for (int d = 0; d < a->num_tjd; d++) {                                              \
+        int start = a->tjd_ptr[d];                                                      \
+        int len = a->tjd_ptr[d + 1] - start;                                            \
+        for (int c = 0; c < len; c++) {                                                 \
+            double v = a->tjd[start + c];                                               \
+            const double *xr = X + (size_t)a->perm[c] * K;                              \
+            double *yr = Y + (size_t)a->row_idx[start + c] * K;                         \
+            _Pragma("omp simd")                                                         \
+            for (int j = 0; j < K; j++) yr[j] += v * xr[j];                             \
+        }                                                                               \
+    }                                                                                   \
+}
+
+CRS_SPMM_KERNEL(2) CRS_SPMM_KERNEL(4)
+CRS_SPMM_KERNEL(8) CRS_SPMM_KERNEL(16) CRS_SPMM_KERNEL(32)
+TJDS_SPMM_KERNEL(2) TJDS_SPMM_KERNEL(4)
+TJDS_SPMM_KERNEL(8) TJDS_SPMM_KERNEL(16) TJDS_SPMM_KERNEL(32)
+
+void crs_spmm_double(const crs_d_t *a, const double *X, int k, double *Y) {
+    switch (k) {
+    case 1: crs_spmv_double(a, X, Y); return;
+    case 2: crs_spmm_k2(a, X, Y); return;
+    case 4: crs_spmm_k4(a, X, Y); return;
+    case 8: crs_spmm_k8(a, X, Y); return;
+    case 16: crs_spmm_k16(a, X, Y); return;
+    case 32: crs_spmm_k32(a, X, Y); return;
+    }
+
+    for (int i = 0; i < a->n_rows; i++) {
+        double *yr = Y + (size_t)i * k;
+        for (int j = 0; j < k; j++) yr[j] = 0.0;
+        for (int p = a->row_ptr[i]; p < a->row_ptr[i + 1]; p++) {
+            double v = a->values[p];
+            const double *xr = X + (size_t)a->col_idx[p] * k;
+            for (int j = 0; j < k; j++) yr[j] += v * xr[j];
+        }
+    }
+}
+
+void tjds_spmm_double(const tjds_d_t *a, const double *X, int k, double *Y) {
+    switch (k) {
+    case 1: tjds_spmv_double(a, X, Y); return;
+    case 2: tjds_spmm_k2(a, X, Y); return;
+    case 4: tjds_spmm_k4(a, X, Y); return;
+    case 8: tjds_spmm_k8(a, X, Y); return;
+    case 16: tjds_spmm_k16(a, X, Y); return;
+    case 32: tjds_spmm_k32(a, X, Y); return;
+    }
+
+    for (size_t q = 0; q < (size_t)a->n_rows * k; q++) Y[q] = 0.0;
+    for (int d = 0; d < a->num_tjd; d++) {
+        int start = a->tjd_ptr[d];
+        int len = a->tjd_ptr[d + 1] - start;
+        for (int c = 0; c < len; c++) {
+            double v = a->tjd[start + c];
+            const double *xr = X + (size_t)a->perm[c] * k;
+            double *yr = Y + (size_t)a->row_idx[start + c] * k;
+            for (int j = 0; j < k; j++) yr[j] += v * xr[j];
+        }
+    }
+}
+
+void crs_spmv_transpose_double(const crs_d_t *a, const double *w, double *z) {
+    for (int j = 0; j < a->n_cols; j++) z[j] = 0.0;
+
+    for (int i = 0; i < a->n_rows; i++) {
+        double wi = w[i];
+        for (int k = a->row_ptr[i]; k < a->row_ptr[i + 1]; k++)
+			z[a->col_idx[k]] += a->values[k] * wi;
+    }
+}
+
+void crs_spmv_fused_double(const crs_d_t *a, const double *x, double *y, const double *w, double *z) {
+    for (int j = 0; j < a->n_cols; j++) z[j] = 0.0;
+
+    for (int i = 0; i < a->n_rows; i++) {
+        double sum = 0.0;
+        double wi = w[i];
+        for (int k = a->row_ptr[i]; k < a->row_ptr[i + 1]; k++) {
+            int j = a->col_idx[k];
+            double v = a->values[k];
+            sum += v * x[j];
+            z[j] += v * wi;
+        }
+        y[i] = sum;
+    }
+}
+
+void jds_spmv_double(const jds_d_t *a, const double *x, double *y, double *work) {
+    if (!work) {
+        for (int i = 0; i < a->n_rows; i++) y[i] = 0.0;
+        for (int d = 0; d < a->num_jd; d++) {
+            int start = a->jdiag_ptr[d];
+            int len = a->jdiag_ptr[d + 1] - start;
+            for (int r = 0; r < len; r++)
+				y[a->perm[r]] += a->jdiag[start + r] * x[a->col_idx[start + r]];
+        }
+        return;
+    }
+
+    for (int r = 0; r < a->n_rows; r++) work[r] = 0.0;
+    for (int d = 0; d < a->num_jd; d++) {
+        int start = a->jdiag_ptr[d];
+        int len = a->jdiag_ptr[d + 1] - start;
+        for (int r = 0; r < len; r++)
+			work[r] += a->jdiag[start + r] * x[a->col_idx[start + r]];
+    }
+    for (int r = 0; r < a->n_rows; r++)
+		y[a->perm[r]] = work[r];
+}
+
+//first row whose start is >= target nnz
+static int lower_bound_row(const int *row_ptr, int n_rows, long long target) {
+    int lo = 0, hi = n_rows;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (row_ptr[mid] < target) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+int crs_partition_nnz(const crs_d_t *a, int nparts, crs_part_t *out) {
+    if (nparts <= 0) nparts = get_num_threads();
+
+    int *row_start = (int *)malloc((size_t)(nparts + 1) * sizeof(int));
+    if (!row_start) return 0;
+
+    row_start[0] = 0;
+    for (int p = 1; p < nparts; p++) {
+        long long target = (long long)a->nnz * p / nparts;
+        int r = lower_bound_row(a->row_ptr, a->n_rows, target);
+        row_start[p] = (r < row_start[p - 1]) ? row_start[p - 1] : r;
+    }
+    row_start[nparts] = a->n_rows;
+
+    out->nparts = nparts;
+    out->row_start = row_start;
+    return 1;
+}
+
+int jds_partition_nnz(const jds_d_t *a, int nparts, crs_part_t *out) {
+    if (nparts <= 0) nparts = get_num_threads();
+
+    //packed row r has one entry in every diagonal longer than r, so the nnz before row r is
+    //sum over d of min(len_d, r); walk the rows once and add the diagonals still covering them
+    int *row_start = (int *)malloc((size_t)(nparts + 1) * sizeof(int));
+    if (!row_start) return 0;
+
+    int p = 1;
+    int alive = a->num_jd;
+    long long before = 0;
+    row_start[0] = 0;
+    for (int r = 0; r < a->n_rows && p < nparts; r++) {
+        while (p < nparts && before >= (long long)a->nnz * p / nparts) row_start[p++] = r;
+        while (alive > 0 && a->jdiag_ptr[alive] - a->jdiag_ptr[alive - 1] <= r) alive--;
+        before += alive;
+    }
+    while (p < nparts) row_start[p++] = a->n_rows;
+    row_start[nparts] = a->n_rows;
+
+    out->nparts = nparts;
+    out->row_start = row_start;
+    return 1;
+}
+
+void free_crs_part(crs_part_t *p) {
+    if (!p) return;
+    free(p->row_start);
+    p->row_start = NULL;
+    p->nparts = 0;
+}
+
+void crs_spmv_double_par(const crs_d_t *a, const crs_part_t *p, const double *x, double *y) {
+    #pragma omp parallel num_threads(p->nparts)
+    {
+        //a smaller team than asked for (thread limit, dynamic teams) still covers every part
+        for (int part = omp_get_thread_num(); part < p->nparts; part += omp_get_num_threads()) {
+            int r0 = p->row_start[part];
+            int r1 = p->row_start[part + 1];
+
+            for (int i = r0; i < r1; i++) {
+                double sum = 0.0;
+                for (int k = a->row_ptr[i]; k < a->row_ptr[i + 1]; k++) {
+                    sum += a->values[k] * x[a->col_idx[k]];
+                }
+                y[i] = sum;
+            }
+        }
+    }
+}
+
+void jds_spmv_double_par(const jds_d_t *a, const crs_part_t *p, const double *x, double *y, double *work) {
+    #pragma omp parallel num_threads(p->nparts)
+    {
+        //parts strided over the team that started, a smaller one than asked for still covers every row
+        for (int part = omp_get_thread_num(); part < p->nparts; part += omp_get_num_threads()) {
+            int r0 = p->row_start[part];
+            int r1 = p->row_start[part + 1];
+
+            for (int r = r0; r < r1; r++) work[r] = 0.0;
+            //diagonals shrink, so stop at the first one that ends before this slice
+            for (int d = 0; d < a->num_jd; d++) {
+                int start = a->jdiag_ptr[d];
+                int len = a->jdiag_ptr[d + 1] - start;
+                if (len <= r0) break;
+                int end = len < r1 ? len : r1;
+                for (int r = r0; r < end; r++)
+					work[r] += a->jdiag[start + r] * x[a->col_idx[start + r]];
+            }
+            for (int r = r0; r < r1; r++)
+				y[a->perm[r]] = work[r];
+        }
+    }
+}
+
+//finds where diagonal d of the (row_end, nnz index) merge grid crosses the path
+static void merge_path_search(const int *row_end, int n_rows, int nnz, long long d, int *out_row, int *out_nz) {
+    long long lo = d - nnz > 0 ? d - nnz : 0;
+    long long hi = d < n_rows ? d : n_rows;
+    while (lo < hi) {
+        long long mid = (lo + hi) / 2;
+        if (row_end[mid] <= d - mid - 1) lo = mid + 1;
+        else hi = mid;
+    }
+    *out_row = (int)lo;
+    *out_nz = (int)(d - lo);
+}
+
+int crs_merge_plan(const crs_d_t *a, int nthreads, crs_merge_t *out) {
+    int nt = (nthreads > 0) ? nthreads : get_num_threads();
+
+    crs_merge_t m;
+    m.nthreads = nt;
+    m.start_row = (int *)malloc((size_t)(nt + 1) * sizeof(int));
+    m.start_nz = (int *)malloc((size_t)(nt + 1) * sizeof(int));
+    m.carry_row = (int *)malloc((size_t)nt * sizeof(int));
+    m.carry_val = (double *)malloc((size_t)nt * sizeof(double));
+    if (!m.start_row || !m.start_nz || !m.carry_row || !m.carry_val) {
+        free_crs_merge(&m);
+        return 0;
+    }
+
+    long long total = (long long)a->n_rows + a->nnz;
+    long long per = (total + nt - 1) / nt;
+    for (int t = 0; t <= nt; t++) {
+        long long d = per * t < total ? per * t : total;
+        merge_path_search(a->row_ptr + 1, a->n_rows, a->nnz, d, &m.start_row[t], &m.start_nz[t]);
+    }
+
+    *out = m;
+    return 1;
+}
+
+void free_crs_merge(crs_merge_t *m) {
+    if (!m) return;
+    free(m->start_row);
+    free(m->start_nz);
+    free(m->carry_row);
+    free(m->carry_val);
+    m->start_row = NULL;
+    m->start_nz = NULL;
+    m->carry_row = NULL;
+    m->carry_val = NULL;
+    m->nthreads = 0;
+}
+
+void crs_spmv_double_merge(const crs_d_t *a, crs_merge_t *m, const double *x, double *y) {
+    const int *row_end = a->row_ptr + 1;
+
+    #pragma omp parallel num_threads(m->nthreads)
+    {
+        //pieces are strided over the team that started, it can be smaller than m->nthreads
+        for (int piece = omp_get_thread_num(); piece < m->nthreads; piece += omp_get_num_threads()) {
+            int row = m->start_row[piece];
+            int nz = m->start_nz[piece];
+            int row_stop = m->start_row[piece + 1];
+            int nz_stop = m->start_nz[piece + 1];
+
+            //rows that end inside this piece, the first one may have started in the previous piece
+            double sum = 0.0;
+            for (; row < row_stop; row++) {
+                for (; nz < row_end[row]; nz++)
+					sum += a->values[nz] * x[a->col_idx[nz]];
+                y[row] = sum;
+                sum = 0.0;
+            }
+
+            //head of a row that keeps going in the next piece
+            for (; nz < nz_stop; nz++)
+				sum += a->values[nz] * x[a->col_idx[nz]];
+
+            m->carry_row[piece] = row_stop;
+            m->carry_val[piece] = sum;
+        }
+    }
+
+    for (int t = 0; t < m->nthreads - 1; t++) {
+        if (m->carry_row[t] < a->n_rows)
+			y[m->carry_row[t]] += m->carry_val[t];
+    }
+}
+
+/* ---- scatter kernels (tjds, ccs) in parallel ---- */
+
+static int scatter_pick_mode(int mode, int nt, int n_rows, int nnz) {
+    if (mode == SCATTER_PRIVATE || mode == SCATTER_OWNER) return mode;
+    return ((long long)nt * n_rows <= (long long)nnz) ? SCATTER_PRIVATE : SCATTER_OWNER;
+}
+
+static int scatter_plan_alloc(scatter_plan_t *p, int nt, int mode, int n_rows, int nnz) {
+    p->nthreads = nt;
+    p->mode = mode;
+    p->n_rows = n_rows;
+    p->work_start = (int *)malloc((size_t)(nt + 1) * sizeof(int));
+    p->ybuf = NULL;
+    p->row_start = NULL;
+    p->ent_ptr = NULL;
+    p->ent_k = NULL;
+    p->ent_col = NULL;
+
+    if (mode == SCATTER_PRIVATE) {
+        p->ybuf = (double *)malloc((size_t)nt * (size_t)n_rows * sizeof(double) + 1);
+        return p->work_start && p->ybuf;
+    }
+
+    p->row_start = (int *)malloc((size_t)(nt + 1) * sizeof(int));
+    p->ent_ptr = (int *)calloc((size_t)nt + 1, sizeof(int));
+    p->ent_k = (int *)malloc((size_t)nnz * sizeof(int) + 1);
+    p->ent_col = (int *)malloc((size_t)nnz * sizeof(int) + 1);
+    return p->work_start && p->row_start && p->ent_ptr && p->ent_k && p->ent_col;
+}
+
+int crs_sym_plan(const crs_sym_d_t *a, int nthreads, sym_plan_t *out) {
+    int nt = (nthreads > 0) ? nthreads : get_num_threads();
+
+    //stored entries are the work, so split like a plain crs of the lower triangle
+    crs_d_t view = { a->n, a->n, a->nnz, a->values, a->col_idx, a->row_ptr };
+    crs_part_t part;
+    if (!crs_partition_nnz(&view, nt, &part)) return 0;
+
+    sym_plan_t p;
+    p.nthreads = nt;
+    p.row_start = part.row_start;
+    p.buf_lo = (int *)malloc((size_t)nt * sizeof(int));
+    p.buf_off = (int *)malloc((size_t)(nt + 1) * sizeof(int));
+    p.ybuf = NULL;
+    if (!p.buf_lo || !p.buf_off) {
+        free_sym_plan(&p);
+        return 0;
+    }
+
+    //lowest mirrored column each thread reaches outside its own rows
+    p.buf_off[0] = 0;
+    for (int t = 0; t < nt; t++) {
+        int r0 = p.row_start[t];
+        int lo = r0;
+        for (int i = r0; i < p.row_start[t + 1]; i++) {
+            for (int k = a->row_ptr[i]; k < a->row_ptr[i + 1]; k++)
+				if (a->col_idx[k] < lo) lo = a->col_idx[k];
+        }
+        p.buf_lo[t] = lo;
+        p.buf_off[t + 1] = p.buf_off[t] + (r0 - lo);
+    }
+
+    p.ybuf = (double *)malloc((size_t)p.buf_off[nt] * sizeof(double) + 1);
+    if (!p.ybuf) {
+        free_sym_plan(&p);
+        return 0;
+    }
+
+    *out = p;
+    return 1;
+}
+
+void free_sym_plan(sym_plan_t *p) {
+    if (!p) return;
+    free(p->row_start);
+    free(p->buf_lo);
+    free(p->buf_off);
+    free(p->ybuf);
+    p->row_start = NULL;
+    p->buf_lo = NULL;
+    p->buf_off = NULL;
+    p->ybuf = NULL;
+    p->nthreads = 0;
+}
+
+void crs_sym_spmv_double_par(const crs_sym_d_t *a, sym_plan_t *p, const double *x, double *y) {
+    double sign = a->skew ? -1.0 : 1.0;
+
+    #pragma omp parallel num_threads(p->nthreads)
+    {
+        //planned pieces are strided over the team that started, every buffer is written before the fold
+        int tid = omp_get_thread_num();
+        int team = omp_get_num_threads();
+
+        for (int t = tid; t < p->nthreads; t += team) {
+            int r0 = p->row_start[t];
+            int r1 = p->row_start[t + 1];
+            int lo = p->buf_lo[t];
+            double *buf = p->ybuf + p->buf_off[t];
+
+            for (int j = lo; j < r0; j++) buf[j - lo] = 0.0;
+            for (int i = r0; i < r1; i++) y[i] = 0.0;
+
+            for (int i = r0; i < r1; i++) {
+                double sum = 0.0;
+                double sxi = sign * x[i];
+                for (int k = a->row_ptr[i]; k < a->row_ptr[i + 1]; k++) {
+                    int j = a->col_idx[k];
+                    sum += a->values[k] * x[j];
+                    if (j >= r0) {
+                        if (j != i) y[j] += a->values[k] * sxi;
+                    } else {
+                        buf[j - lo] += a->values[k] * sxi;
+                    }
+                }
+                y[i] += sum;
+            }
+        }
+
+        #pragma omp barrier
+
+        //each piece folds the buffers of the pieces above it into its own rows
+        for (int t = tid; t < p->nthreads; t += team) {
+            int r0 = p->row_start[t];
+            int r1 = p->row_start[t + 1];
+            for (int u = t + 1; u < p->nthreads; u++) {
+                int j0 = p->buf_lo[u] > r0 ? p->buf_lo[u] : r0;
+                int j1 = p->row_start[u] < r1 ? p->row_start[u] : r1;
+                const double *bu = p->ybuf + p->buf_off[u];
+                for (int j = j0; j < j1; j++) y[j] += bu[j - p->buf_lo[u]];
+            }
+        }
+    }
+}
+
+void free_scatter_plan(scatter_plan_t *p) {
+    if (!p) return;
+    free(p->work_start);
+    free(p->ybuf);
+    free(p->row_start);
+    free(p->ent_ptr);
+    free(p->ent_k);
+    free(p->ent_col);
+    p->work_start = NULL;
+    p->ybuf = NULL;
+    p->row_start = NULL;
+    p->ent_ptr = NULL;
+    p->ent_k = NULL;
+    p->ent_col = NULL;
+    p->nthreads = 0;
+}
+
+const char *scatter_mode_name(int mode) {
+    if (mode == SCATTER_PRIVATE) return "private";
+    if (mode == SCATTER_OWNER) return "owner";
+    return "auto";
+}
+
+//row ranges with ~equal entry counts, owner[] gets the thread of every row
+static void scatter_split_rows(scatter_plan_t *p, const int *row_idx, int nnz, int *owner) {
+    int n_rows = p->n_rows, nt = p->nthreads;
+
+    for (int i = 0; i < n_rows; i++) owner[i] = 0;
+    for (int k = 0; k < nnz; k++) owner[row_idx[k]]++;
+
+    long long run = 0;
+    int t = 0;
+    p->row_start[0] = 0;
+    for (int i = 0; i < n_rows; i++) {
+        while (t + 1 < nt && run >= (long long)nnz * (t + 1) / nt)
+			p->row_start[++t] = i;
+        run += owner[i];
+        owner[i] = t;
+    }
+    while (t + 1 <= nt)
+		p->row_start[++t] = n_rows;
+}
+
+int tjds_par_plan(const tjds_d_t *a, int nthreads, int mode, scatter_plan_t *out) {
+    int nt = (nthreads > 0) ? nthreads : get_num_threads();
+    scatter_plan_t p;
+    if (!scatter_plan_alloc(&p, nt, scatter_pick_mode(mode, nt, a->n_rows, a->nnz), a->n_rows, a->nnz)) {
+        free_scatter_plan(&p);
+        return 0;
+    }
+
+    //private mode: thread t takes entries [work_start[t], work_start[t+1])
+    for (int t = 0; t <= nt; t++)
+		p.work_start[t] = (int)((long long)a->nnz * t / nt);
+
+    if (p.mode == SCATTER_OWNER) {
+        int *owner = (int *)malloc((size_t)a->n_rows * sizeof(int) + 1);
+        if (!owner) { free_scatter_plan(&p); return 0; }
+        scatter_split_rows(&p, a->row_idx, a->nnz, owner);
+
+        for (int k = 0; k < a->nnz; k++)
+			p.ent_ptr[owner[a->row_idx[k]] + 1]++;
+        for (int t = 0; t < nt; t++)
+			p.ent_ptr[t + 1] += p.ent_ptr[t];
+
+        //work_start is not used in owner mode, borrow it as the fill cursor
+        int *next = p.work_start;
+        for (int t = 0; t < nt; t++)
+			next[t] = p.ent_ptr[t];
+        for (int d = 0; d < a->num_tjd; d++) {
+            for (int k = a->tjd_ptr[d]; k < a->tjd_ptr[d + 1]; k++) {
+                int pos = next[owner[a->row_idx[k]]]++;
+                p.ent_k[pos] = k;
+                p.ent_col[pos] = a->perm[k - a->tjd_ptr[d]];
+            }
+        }
+        free(owner);
+    }
+
+    *out = p;
+    return 1;
+}
+
+int ccs_par_plan(const ccs_d_t *a, int nthreads, int mode, scatter_plan_t *out) {
+    int nt = (nthreads > 0) ? nthreads : get_num_threads();
+    scatter_plan_t p;
+    if (!scatter_plan_alloc(&p, nt, scatter_pick_mode(mode, nt, a->n_rows, a->nnz), a->n_rows, a->nnz)) {
+        free_scatter_plan(&p);
+        return 0;
+    }
+
+    //private mode: column ranges with ~equal nnz, like crs_partition_nnz on rows
+    p.work_start[0] = 0;
+    for (int t = 1; t < nt; t++) {
+        long long target = (long long)a->nnz * t / nt;
+        int j = lower_bound_row(a->col_ptr, a->n_cols, target);
+        p.work_start[t] = (j < p.work_start[t - 1]) ? p.work_start[t - 1] : j;
+    }
+    p.work_start[nt] = a->n_cols;
+
+    if (p.mode == SCATTER_OWNER) {
+        int *owner = (int *)malloc((size_t)a->n_rows * sizeof(int) + 1);
+        if (!owner) { free_scatter_plan(&p); return 0; }
+        scatter_split_rows(&p, a->row_idx, a->nnz, owner);
+
+        for (int k = 0; k < a->nnz; k++)
+			p.ent_ptr[owner[a->row_idx[k]] + 1]++;
+        for (int t = 0; t < nt; t++)
+			p.ent_ptr[t + 1] += p.ent_ptr[t];
+
+        int *next = p.work_start;
+        for (int t = 0; t < nt; t++)
+			next[t] = p.ent_ptr[t];
+        for (int j = 0; j < a->n_cols; j++) {
+            for (int k = a->col_ptr[j]; k < a->col_ptr[j + 1]; k++) {
+                int pos = next[owner[a->row_idx[k]]]++;
+                p.ent_k[pos] = k;
+                p.ent_col[pos] = j;
+            }
+        }
+        free(owner);
+    }
+
+    *out = p;
+    return 1;
+}
+
+//sum all p->nthreads private buffers into y, the rows are split over the team that actually
+//started (tid of team), which can be smaller than the plan
+static void scatter_reduce(scatter_plan_t *p, double *y, int tid, int team) {
+    int n = p->n_rows, nt = p->nthreads;
+    int i0 = (int)((long long)n * tid / team);
+    int i1 = (int)((long long)n * (tid + 1) / team);
+    for (int i = i0; i < i1; i++) {
+        double s = 0.0;
+        for (int t = 0; t < nt; t++)
+			s += p->ybuf[(size_t)t * (size_t)n + i];
+        y[i] = s;
+    }
+}
+
+//owner mode is the same loop for both formats, only the value array differs. slices are
+//strided over the team so a smaller one than planned still writes every row
+static void scatter_owner(scatter_plan_t *p, const double *vals, const int *row_idx, const double *x, double *y,
+                          int tid, int team) {
+    for (int o = tid; o < p->nthreads; o += team) {
+        for (int i = p->row_start[o]; i < p->row_start[o + 1]; i++) y[i] = 0.0;
+        for (int e = p->ent_ptr[o]; e < p->ent_ptr[o + 1]; e++) {
+            int k = p->ent_k[e];
+            y[row_idx[k]] += vals[k] * x[p->ent_col[e]];
+        }
+    }
+}
+
+int crs_trans_plan(const crs_d_t *a, int nthreads, scatter_plan_t *out) {
+    int nt = (nthreads > 0) ? nthreads : get_num_threads();
+    crs_part_t part;
+    if (!crs_partition_nnz(a, nt, &part)) return 0;
+
+    //output of the transpose has n_cols entries, so that is the buffer length
+    scatter_plan_t p;
+    if (!scatter_plan_alloc(&p, nt, SCATTER_PRIVATE, a->n_cols, a->nnz)) {
+        free_crs_part(&part);
+        free_scatter_plan(&p);
+        return 0;
+    }
+    for (int t = 0; t <= nt; t++) p.work_start[t] = part.row_start[t];
+    free_crs_part(&part);
+
+    *out = p;
+    return 1;
+}
+
+void crs_spmv_transpose_double_par(const crs_d_t *a, scatter_plan_t *p, const double *w, double *z) {
+    #pragma omp parallel num_threads(p->nthreads)
+    {
+        int tid = omp_get_thread_num();
+        int team = omp_get_num_threads();
+
+        //every planned row range fills its own buffer, whichever thread of a smaller team runs it
+        for (int t = tid; t < p->nthreads; t += team) {
+            double *zb = p->ybuf + (size_t)t * (size_t)a->n_cols;
+            for (int j = 0; j < a->n_cols; j++) zb[j] = 0.0;
+
+            for (int i = p->work_start[t]; i < p->work_start[t + 1]; i++) {
+                double wi = w[i];
+                for (int k = a->row_ptr[i]; k < a->row_ptr[i + 1]; k++)
+					zb[a->col_idx[k]] += a->values[k] * wi;
+            }
+        }
+
+        #pragma omp barrier
+        scatter_reduce(p, z, tid, team);
+    }
+}
+
+void crs_spmv_fused_double_par(const crs_d_t *a, scatter_plan_t *p, const double *x, double *y,
+                               const double *w, double *z) {
+    #pragma omp parallel num_threads(p->nthreads)
+    {
+        int tid = omp_get_thread_num();
+        int team = omp_get_num_threads();
+
+        for (int t = tid; t < p->nthreads; t += team) {
+            double *zb = p->ybuf + (size_t)t * (size_t)a->n_cols;
+            for (int j = 0; j < a->n_cols; j++) zb[j] = 0.0;
+
+            for (int i = p->work_start[t]; i < p->work_start[t + 1]; i++) {
+                double sum = 0.0;
+                double wi = w[i];
+                for (int k = a->row_ptr[i]; k < a->row_ptr[i + 1]; k++) {
+                    int j = a->col_idx[k];
+                    double v = a->values[k];
+                    sum += v * x[j];
+                    zb[j] += v * wi;
+                }
+                y[i] = sum;
+            }
+        }
+
+        #pragma omp barrier
+        scatter_reduce(p, z, tid, team);
+    }
+}
+
+void tjds_spmv_double_par(const tjds_d_t *a, scatter_plan_t *p, const double *x, double *y) {
+    #pragma omp parallel num_threads(p->nthreads)
+    {
+        int tid = omp_get_thread_num();
+        int team = omp_get_num_threads();
+
+        if (p->mode == SCATTER_OWNER) {
+            scatter_owner(p, a->tjd, a->row_idx, x, y, tid, team);
+        } else {
+            //every planned piece fills its own buffer, whichever thread runs it
+            for (int w = tid; w < p->nthreads; w += team) {
+                double *yb = p->ybuf + (size_t)w * (size_t)a->n_rows;
+                for (int i = 0; i < a->n_rows; i++) yb[i] = 0.0;
+
+                int k0 = p->work_start[w];
+                int k1 = p->work_start[w + 1];
+                //diagonal holding k0
+                int d = lower_bound_row(a->tjd_ptr, a->num_tjd, k0 + 1) - 1;
+                if (d < 0) d = 0;
+
+                for (int k = k0; k < k1; d++) {
+                    int start = a->tjd_ptr[d];
+                    int end = a->tjd_ptr[d + 1] < k1 ? a->tjd_ptr[d + 1] : k1;
+                    for (; k < end; k++)
+						yb[a->row_idx[k]] += a->tjd[k] * x[a->perm[k - start]];
+                }
+            }
+
+            #pragma omp barrier
+            scatter_reduce(p, y, tid, team);
+        }
+    }
+}
+
+void ccs_spmv_double_par(const ccs_d_t *a, scatter_plan_t *p, const double *x, double *y) {
+    #pragma omp parallel num_threads(p->nthreads)
+    {
+        int tid = omp_get_thread_num();
+        int team = omp_get_num_threads();
+
+        if (p->mode == SCATTER_OWNER) {
+            scatter_owner(p, a->values, a->row_idx, x, y, tid, team);
+        } else {
+            for (int w = tid; w < p->nthreads; w += team) {
+                double *yb = p->ybuf + (size_t)w * (size_t)a->n_rows;
+                for (int i = 0; i < a->n_rows; i++) yb[i] = 0.0;
+
+                for (int j = p->work_start[w]; j < p->work_start[w + 1]; j++) {
+                    double xj = x[j];
+                    for (int k = a->col_ptr[j]; k < a->col_ptr[j + 1]; k++)
+						yb[a->row_idx[k]] += a->values[k] * xj;
+                }
+            }
+
+            #pragma omp barrier
+            scatter_reduce(p, y, tid, team);
+        }
+    }
+}
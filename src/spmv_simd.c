@@ -0,0 +1,332 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "spmv.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SPMV_X86 1
+#endif
+
+/* ---- scalar ---- */
+
+static void crs_spmv_double_scalar(const crs_d_t *a, const double *x, double *y) {
+    crs_spmv_double(a, x, y);
+}
+
+static void tjds_spmv_double_scalar(const tjds_d_t *a, const double *x, double *y) {
+    tjds_spmv_double(a, x, y);
+}
+
+#ifdef SPMV_X86
+
+/* ---- sse2, no gather so x is loaded two lanes at a time ---- */
+
+static void crs_spmv_double_sse2(const crs_d_t *a, const double *x, double *y) {
+    const double *val = a->values;
+    const int *col = a->col_idx;
+
+    for (int i = 0; i < a->n_rows; i++) {
+        int k = a->row_ptr[i];
+        int end = a->row_ptr[i + 1];
+        __m128d acc0 = _mm_setzero_pd();
+        __m128d acc1 = _mm_setzero_pd();
+
+        for (; k + 4 <= end; k += 4) {
+            __m128d x0 = _mm_set_pd(x[col[k + 1]], x[col[k]]);
+            __m128d x1 = _mm_set_pd(x[col[k + 3]], x[col[k + 2]]);
+            acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(val + k), x0));
+            acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_loadu_pd(val + k + 2), x1));
+        }
+
+        acc0 = _mm_add_pd(acc0, acc1);
+        double sum = _mm_cvtsd_f64(acc0) + _mm_cvtsd_f64(_mm_unpackhi_pd(acc0, acc0));
+        for (; k < end; k++)
+			sum += val[k] * x[col[k]];
+        y[i] = sum;
+    }
+}
+
+/* ---- avx2: 4 wide gathers, two accumulators ---- */
+
+__attribute__((target("avx2,fma")))
+static void crs_spmv_double_avx2(const crs_d_t *a, const double *x, double *y) {
+    const double *val = a->values;
+    const int *col = a->col_idx;
+
+    for (int i = 0; i < a->n_rows; i++) {
+        int k = a->row_ptr[i];
+        int end = a->row_ptr[i + 1];
+        __m256d acc0 = _mm256_setzero_pd();
+        __m256d acc1 = _mm256_setzero_pd();
+
+        for (; k + 8 <= end; k += 8) {
+            __m128i i0 = _mm_loadu_si128((const __m128i *)(col + k));
+            __m128i i1 = _mm_loadu_si128((const __m128i *)(col + k + 4));
+            __m256d x0 = _mm256_i32gather_pd(x, i0, 8);
+            __m256d x1 = _mm256_i32gather_pd(x, i1, 8);
+            acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(val + k), x0, acc0);
+            acc1 = _mm256_fmadd_pd(_mm256_loadu_pd(val + k + 4), x1, acc1);
+        }
+        if (k + 4 <= end) {
+            __m128i i0 = _mm_loadu_si128((const __m128i *)(col + k));
+            acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(val + k), _mm256_i32gather_pd(x, i0, 8), acc0);
+            k += 4;
+        }
+
+        acc0 = _mm256_add_pd(acc0, acc1);
+        __m128d h = _mm_add_pd(_mm256_castpd256_pd128(acc0), _mm256_extractf128_pd(acc0, 1));
+        double sum = _mm_cvtsd_f64(h) + _mm_cvtsd_f64(_mm_unpackhi_pd(h, h));
+        for (; k < end; k++)
+			sum += val[k] * x[col[k]];
+        y[i] = sum;
+    }
+}
+
+//columns of one diagonal are contiguous in perm, so x can be gathered and multiplied 4 at a
+//time; rows inside a diagonal can repeat, so the adds into y stay scalar and in order
+__attribute__((target("avx2,fma")))
+static void tjds_spmv_double_avx2(const tjds_d_t *a, const double *x, double *y) {
+    for (int i = 0; i < a->n_rows; i++) y[i] = 0.0;
+
+    double prod[4];
+    for (int d = 0; d < a->num_tjd; d++) {
+        int start = a->tjd_ptr[d];
+        int len = a->tjd_ptr[d + 1] - start;
+        const double *v = a->tjd + start;
+        const int *row = a->row_idx + start;
+
+        int c = 0;
+        for (; c + 4 <= len; c += 4) {
+            __m128i ic = _mm_loadu_si128((const __m128i *)(a->perm + c));
+            _mm256_storeu_pd(prod, _mm256_mul_pd(_mm256_loadu_pd(v + c), _mm256_i32gather_pd(x, ic, 8)));
+            y[row[c]] += prod[0];
+            y[row[c + 1]] += prod[1];
+            y[row[c + 2]] += prod[2];
+            y[row[c + 3]] += prod[3];
+        }
+        for (; c < len; c++)
+			y[row[c]] += v[c] * x[a->perm[c]];
+    }
+}
+
+/* ---- avx-512: 8 wide gathers, two accumulators ---- */
+
+__attribute__((target("avx512f")))
+static void crs_spmv_double_avx512(const crs_d_t *a, const double *x, double *y) {
+    const double *val = a->values;
+    const int *col = a->col_idx;
+
+    for (int i = 0; i < a->n_rows; i++) {
+        int k = a->row_ptr[i];
+        int end = a->row_ptr[i + 1];
+        __m512d acc0 = _mm512_setzero_pd();
+        __m512d acc1 = _mm512_setzero_pd();
+
+        for (; k + 16 <= end; k += 16) {
+            __m256i i0 = _mm256_loadu_si256((const __m256i *)(col + k));
+            __m256i i1 = _mm256_loadu_si256((const __m256i *)(col + k + 8));
+            acc0 = _mm512_fmadd_pd(_mm512_loadu_pd(val + k), _mm512_i32gather_pd(i0, x, 8), acc0);
+            acc1 = _mm512_fmadd_pd(_mm512_loadu_pd(val + k + 8), _mm512_i32gather_pd(i1, x, 8), acc1);
+        }
+        if (k + 8 <= end) {
+            __m256i i0 = _mm256_loadu_si256((const __m256i *)(col + k));
+            acc0 = _mm512_fmadd_pd(_mm512_loadu_pd(val + k), _mm512_i32gather_pd(i0, x, 8), acc0);
+            k += 8;
+        }
+        //tail of 4..7 entries under a mask, shorter tails are cheaper scalar
+        double tail = 0.0;
+        if (end - k >= 4) {
+            __mmask8 m = (__mmask8)((1u << (end - k)) - 1u);
+            __m512i i0 = _mm512_maskz_loadu_epi32((__mmask16)m, col + k);
+            __m512d xv = _mm512_mask_i32gather_pd(_mm512_setzero_pd(), m, _mm512_castsi512_si256(i0), x, 8);
+            acc1 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(m, val + k), xv, acc1);
+        } else {
+            for (; k < end; k++)
+				tail += val[k] * x[col[k]];
+        }
+
+        y[i] = _mm512_reduce_add_pd(_mm512_add_pd(acc0, acc1)) + tail;
+    }
+}
+
+__attribute__((target("avx512f")))
+static void tjds_spmv_double_avx512(const tjds_d_t *a, const double *x, double *y) {
+    for (int i = 0; i < a->n_rows; i++) y[i] = 0.0;
+
+    double prod[8];
+    for (int d = 0; d < a->num_tjd; d++) {
+        int start = a->tjd_ptr[d];
+        int len = a->tjd_ptr[d + 1] - start;
+        const double *v = a->tjd + start;
+        const int *row = a->row_idx + start;
+
+        int c = 0;
+        for (; c + 8 <= len; c += 8) {
+            __m256i ic = _mm256_loadu_si256((const __m256i *)(a->perm + c));
+            _mm512_storeu_pd(prod, _mm512_mul_pd(_mm512_loadu_pd(v + c), _mm512_i32gather_pd(ic, x, 8)));
+            for (int l = 0; l < 8; l++)
+				y[row[c + l]] += prod[l];
+        }
+        for (; c < len; c++)
+			y[row[c]] += v[c] * x[a->perm[c]];
+    }
+}
+
+/* ---- sell-c-sigma, one chunk = one register of C lanes ---- */
+
+__attribute__((target("avx2,fma")))
+static void sell_spmv_double_avx2(const sell_d_t *a, const double *x, double *y) {
+    double out[4];
+    for (int ch = 0; ch < a->n_chunks; ch++) {
+        int off = a->chunk_ptr[ch];
+        int len = a->chunk_len[ch];
+        __m256d acc0 = _mm256_setzero_pd();
+        __m256d acc1 = _mm256_setzero_pd();
+
+        int j = 0;
+        for (; j + 2 <= len; j += 2, off += 8) {
+            __m128i i0 = _mm_load_si128((const __m128i *)(a->col_idx + off));
+            __m128i i1 = _mm_load_si128((const __m128i *)(a->col_idx + off + 4));
+            acc0 = _mm256_fmadd_pd(_mm256_load_pd(a->values + off), _mm256_i32gather_pd(x, i0, 8), acc0);
+            acc1 = _mm256_fmadd_pd(_mm256_load_pd(a->values + off + 4), _mm256_i32gather_pd(x, i1, 8), acc1);
+        }
+        if (j < len) {
+            __m128i i0 = _mm_load_si128((const __m128i *)(a->col_idx + off));
+            acc0 = _mm256_fmadd_pd(_mm256_load_pd(a->values + off), _mm256_i32gather_pd(x, i0, 8), acc0);
+        }
+
+        _mm256_storeu_pd(out, _mm256_add_pd(acc0, acc1));
+        const int *perm = a->perm + ch * 4;
+        for (int l = 0; l < 4; l++)
+			if (perm[l] >= 0) y[perm[l]] = out[l];
+    }
+}
+
+__attribute__((target("avx512f")))
+static void sell_spmv_double_avx512(const sell_d_t *a, const double *x, double *y) {
+    double out[8];
+    for (int ch = 0; ch < a->n_chunks; ch++) {
+        int off = a->chunk_ptr[ch];
+        int len = a->chunk_len[ch];
+        __m512d acc0 = _mm512_setzero_pd();
+        __m512d acc1 = _mm512_setzero_pd();
+
+        int j = 0;
+        for (; j + 2 <= len; j += 2, off += 16) {
+            __m256i i0 = _mm256_load_si256((const __m256i *)(a->col_idx + off));
+            __m256i i1 = _mm256_load_si256((const __m256i *)(a->col_idx + off + 8));
+            acc0 = _mm512_fmadd_pd(_mm512_load_pd(a->values + off), _mm512_i32gather_pd(i0, x, 8), acc0);
+            acc1 = _mm512_fmadd_pd(_mm512_load_pd(a->values + off + 8), _mm512_i32gather_pd(i1, x, 8), acc1);
+        }
+        if (j < len) {
+            __m256i i0 = _mm256_load_si256((const __m256i *)(a->col_idx + off));
+            acc0 = _mm512_fmadd_pd(_mm512_load_pd(a->values + off), _mm512_i32gather_pd(i0, x, 8), acc0);
+        }
+
+        _mm512_storeu_pd(out, _mm512_add_pd(acc0, acc1));
+        const int *perm = a->perm + ch * 8;
+        for (int l = 0; l < 8; l++)
+			if (perm[l] >= 0) y[perm[l]] = out[l];
+    }
+}
+
+#endif
+
+/* ---- dispatch ---- */
+
+static int g_simd_level = -1;
+static crs_d_kernel_t g_crs_kernel = crs_spmv_double_scalar;
+static tjds_d_kernel_t g_tjds_kernel = tjds_spmv_double_scalar;
+
+const char *simd_name(int level) {
+    switch (level) {
+    case SIMD_SSE2: return "sse2";
+    case SIMD_AVX2: return "avx2";
+    case SIMD_AVX512: return "avx512";
+    default: return "scalar";
+    }
+}
+
+int simd_detect(void) {
+    int level = SIMD_SCALAR;
+#ifdef SPMV_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) level = SIMD_SSE2;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) level = SIMD_AVX2;
+    if (__builtin_cpu_supports("avx512f")) level = SIMD_AVX512;
+#endif
+
+    //SPMV_SIMD=scalar|sse2|avx2|avx512 caps the level, handy for comparing hosts
+    const char *env = getenv("SPMV_SIMD");
+    if (env) {
+        for (int l = SIMD_SCALAR; l <= SIMD_AVX512; l++) {
+            if (strcmp(env, simd_name(l)) == 0 && l < level) level = l;
+        }
+    }
+    return level;
+}
+
+crs_d_kernel_t crs_spmv_double_kernel(int level) {
+    switch (level) {
+    case SIMD_SCALAR: return crs_spmv_double_scalar;
+#ifdef SPMV_X86
+    case SIMD_SSE2: return crs_spmv_double_sse2;
+    case SIMD_AVX2: return crs_spmv_double_avx2;
+    case SIMD_AVX512: return crs_spmv_double_avx512;
+#endif
+    default: return NULL;
+    }
+}
+
+//sse2 has no gather, the scalar loop is as good as it gets there
+tjds_d_kernel_t tjds_spmv_double_kernel(int level) {
+    switch (level) {
+    case SIMD_SCALAR: return tjds_spmv_double_scalar;
+#ifdef SPMV_X86
+    case SIMD_SSE2: return tjds_spmv_double_scalar;
+    case SIMD_AVX2: return tjds_spmv_double_avx2;
+    case SIMD_AVX512: return tjds_spmv_double_avx512;
+#endif
+    default: return NULL;
+    }
+}
+
+int simd_level(void) {
+    if (g_simd_level < 0) {
+        int level = simd_detect();
+        g_crs_kernel = crs_spmv_double_kernel(level);
+        g_tjds_kernel = tjds_spmv_double_kernel(level);
+        g_simd_level = level;
+    }
+    return g_simd_level;
+}
+
+void crs_spmv_double_simd(const crs_d_t *a, const double *x, double *y) {
+    if (g_simd_level < 0) simd_level();
+    g_crs_kernel(a, x, y);
+}
+
+void tjds_spmv_double_simd(const tjds_d_t *a, const double *x, double *y) {
+    if (g_simd_level < 0) simd_level();
+    g_tjds_kernel(a, x, y);
+}
+
+int sell_simd_C(void) {
+    switch (simd_level()) {
+    case SIMD_AVX512: return 8;
+    case SIMD_AVX2: return 4;
+    case SIMD_SSE2: return 2;
+    default: return 4;
+    }
+}
+
+void sell_spmv_double_simd(const sell_d_t *a, const double *x, double *y) {
+#ifdef SPMV_X86
+    int level = simd_level();
+    if (level == SIMD_AVX512 && a->C == 8) { sell_spmv_double_avx512(a, x, y); return; }
+    if (level >= SIMD_AVX2 && a->C == 4) { sell_spmv_double_avx2(a, x, y); return; }
+#endif
+    sell_spmv_double(a, x, y);
+}
@@ -0,0 +1,298 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tune.h"
+#include "spmv.h"
+#include "bench.h"
+#include "util.h"
+
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME  0x100000001b3ULL
+#define FP_CHUNK   (1 << 20)
+
+void tune_opts_default(tune_opts_t *o) {
+    memset(o, 0, sizeof(*o));
+    o->trial_ns = 20000000;
+}
+
+static unsigned long long fnv_ints(unsigned long long h, const int *p, long long n) {
+    const unsigned char *b = (const unsigned char *)p;
+    for (long long i = 0; i < n * (long long)sizeof(int); i++)
+		h = (h ^ b[i]) * FNV_PRIME;
+    return h;
+}
+
+//chunk hashes in parallel, folded in chunk order
+static unsigned long long fnv_array(unsigned long long h, const int *p, long long n) {
+    long long nch = (n + FP_CHUNK - 1) / FP_CHUNK;
+    unsigned long long *part = (unsigned long long *)malloc((size_t)nch * sizeof(unsigned long long) + 1);
+    if (!part) return fnv_ints(h, p, n);
+
+    #pragma omp parallel for schedule(static)
+    for (long long c = 0; c < nch; c++) {
+        long long lo = c * FP_CHUNK;
+        long long len = (n - lo < FP_CHUNK) ? n - lo : FP_CHUNK;
+        part[c] = fnv_ints(FNV_OFFSET, p + lo, len);
+    }
+    for (long long c = 0; c < nch; c++)
+		h = (h ^ part[c]) * FNV_PRIME;
+    free(part);
+    return h;
+}
+
+unsigned long long crs_fingerprint(const crs_d_t *a) {
+    int shape[3] = { a->n_rows, a->n_cols, a->nnz };
+    unsigned long long h = fnv_ints(FNV_OFFSET, shape, 3);
+    h = fnv_array(h, a->row_ptr, (long long)a->n_rows + 1);
+    return fnv_array(h, a->col_idx, a->nnz);
+}
+
+/* ---- cache ---- */
+
+static int is_candidate(const tune_opts_t *o, const spmv_variant_t *v) {
+    if (!o->fmt) return 1;
+    for (int i = 0; i < o->n_fmt; i++)
+		if (o->fmt[i] == v) return 1;
+    return 0;
+}
+
+//hash of what was allowed to win: candidate names, thread list, budget. a run restricted
+//to a few formats gets its own cache line instead of overwriting the full one
+static unsigned long long options_key(const tune_opts_t *o) {
+    unsigned long long h = FNV_OFFSET;
+    for (int q = 0; q < spmv_variant_count(); q++) {
+        const spmv_variant_t *v = spmv_variant_at(q);
+        if (o->fmt && !is_candidate(o, v)) continue;
+        for (const char *c = v->name; *c; c++)
+			h = (h ^ (unsigned char)*c) * FNV_PRIME;
+        h = (h ^ ',') * FNV_PRIME;
+    }
+    if (o->threads) h = fnv_ints(h, o->threads, o->n_threads);
+    long long budget = o->mem_budget > 0 ? o->mem_budget : 0;
+    return fnv_ints(h, (const int *)&budget, (long long)(sizeof(budget) / sizeof(int)));
+}
+
+//one line per decision: fingerprint options max_threads format threads ns. max_threads is
+//get_num_threads() at tuning time, so a different machine / OMP_NUM_THREADS tunes again
+static int cache_lookup(const char *path, unsigned long long fp, unsigned long long opt, int max_threads, char *name,
+                        size_t name_len, int *threads, double *ns) {
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+
+    char line[256];
+    int found = 0;
+    while (fgets(line, sizeof(line), f)) {
+        unsigned long long lfp, lopt;
+        int lmax, lthr;
+        double lns;
+        char lname[64];
+        if (line[0] == '#') continue;
+        if (sscanf(line, "%llx %llx %d %63s %d %lf", &lfp, &lopt, &lmax, lname, &lthr, &lns) != 6) continue;
+        if (lfp != fp || lopt != opt || lmax != max_threads) continue;
+        //later lines win, the file is rewritten on every store anyway
+        snprintf(name, name_len, "%s", lname);
+        *threads = lthr;
+        *ns = lns;
+        found = 1;
+    }
+    fclose(f);
+    return found;
+}
+
+//rewrites the file without any old line for this key plus the new one, through a temp file
+//and rename so a crash never leaves half a cache
+static int cache_store(const char *path, unsigned long long fp, unsigned long long opt, int max_threads,
+                       const char *name, int threads, double ns) {
+    size_t len = strlen(path) + 8;
+    char *tmp = (char *)malloc(len);
+    if (!tmp) return 0;
+    snprintf(tmp, len, "%s.tmp", path);
+
+    FILE *out = fopen(tmp, "w");
+    if (!out) { free(tmp); return 0; }
+    fprintf(out, "# spmv autotune cache: fingerprint options max_threads format threads ns_per_spmv\n");
+
+    FILE *in = fopen(path, "r");
+    if (in) {
+        char line[256];
+        while (fgets(line, sizeof(line), in)) {
+            unsigned long long lfp, lopt;
+            int lmax;
+            if (line[0] == '#') continue;
+            if (sscanf(line, "%llx %llx %d", &lfp, &lopt, &lmax) == 3 && lfp == fp && lopt == opt &&
+                lmax == max_threads)
+                continue;
+            fputs(line, out);
+        }
+        fclose(in);
+    }
+    fprintf(out, "%016llx %016llx %d %s %d %.1f\n", fp, opt, max_threads, name, threads, ns);
+
+    int ok = !ferror(out);
+    if (fclose(out) != 0) ok = 0;
+    if (ok && rename(tmp, path) != 0) ok = 0;
+    if (!ok) remove(tmp);
+    free(tmp);
+    return ok;
+}
+
+/* ---- trials ---- */
+
+static int fits(const tune_opts_t *o, const spmv_variant_t *v, const crs_d_t *a, int threads) {
+    return o->mem_budget <= 0 || v->mem(a, threads) <= o->mem_budget;
+}
+
+//what the built handle really keeps: the arrays traffic counts (unless borrowed from a) or the
+//mem estimate, whichever is larger, since mem also counts scratch traffic doesn't (scatter plans)
+static long long built_mem(const spmv_variant_t *v, void *h, const crs_d_t *a, int threads) {
+    long long est = v->mem(a, threads);
+    if (v->borrows) return est;
+    spmv_traffic_t tr;
+    v->traffic(h, &tr);
+    return tr.values + tr.index > est ? tr.values + tr.index : est;
+}
+
+static int fits_built(const tune_opts_t *o, const spmv_variant_t *v, void *h, const crs_d_t *a, int threads) {
+    return o->mem_budget <= 0 || built_mem(v, h, a, threads) <= o->mem_budget;
+}
+
+//best per call time of 5 batches filling trial_ns between them
+static double trial(const spmv_variant_t *v, void *h, const double *x, double *y, double first_ns,
+                    long long trial_ns) {
+    v->run(h, x, y);
+    v->run(h, x, y);
+
+    double per_batch = (double)trial_ns / 5.0;
+    int calls = first_ns > 0.0 ? (int)(per_batch / first_ns) : 1;
+    if (calls < 1) calls = 1;
+    if (calls > 100000) calls = 100000;
+
+    double best = 0.0;
+    for (int b = 0; b < 5; b++) {
+        long long t0 = now_ns();
+        for (int k = 0; k < calls; k++) v->run(h, x, y);
+        double per = (double)(now_ns() - t0) / calls;
+        if (b == 0 || per < best) best = per;
+    }
+    return best;
+}
+
+static int from_cache(const crs_d_t *a, const tune_opts_t *o, int max_threads, spmv_tuned_t *out) {
+    char name[64];
+    int threads = 0;
+    double ns = 0.0;
+    if (!cache_lookup(o->cache_path, out->fingerprint, options_key(o), max_threads, name, sizeof(name), &threads,
+                      &ns))
+        return 0;
+
+    const spmv_variant_t *v = spmv_variant_find(name);
+    if (!v || !is_candidate(o, v) || threads < 1 || !fits(o, v, a, threads)) return 0;
+    void *h = v->build(a, threads);
+    if (!h) return 0;
+    if (!fits_built(o, v, h, a, threads)) {
+        v->release(h);
+        return 0;
+    }
+
+    out->v = v;
+    out->h = h;
+    out->threads = threads;
+    out->ns = ns;
+    out->from_cache = 1;
+    if (o->verbose) printf("tune: cache hit %016llx -> %s threads = %d (%.0f ns)\n", out->fingerprint, name, threads, ns);
+    return 1;
+}
+
+int spmv_autotune(const crs_d_t *a, const tune_opts_t *o, spmv_tuned_t *out) {
+    memset(out, 0, sizeof(*out));
+    int max_threads = get_num_threads();
+    out->fingerprint = crs_fingerprint(a);
+    if (o->cache_path && from_cache(a, o, max_threads, out)) return 1;
+
+    long long trial_ns = o->trial_ns > 0 ? o->trial_ns : 20000000;
+    double *x = (double *)malloc((size_t)a->n_cols * sizeof(double) + 1);
+    double *y_ref = (double *)malloc((size_t)a->n_rows * sizeof(double) + 1);
+    double *y = (double *)malloc((size_t)a->n_rows * sizeof(double) + 1);
+    if (!x || !y_ref || !y) {
+        free(x); free(y_ref); free(y);
+        return 0;
+    }
+    for (int i = 0; i < a->n_cols; i++)
+		x[i] = 1.0 / (i + 1);
+    crs_spmv_double(a, x, y_ref);
+
+    int one = max_threads;
+    const int *tl = o->threads ? o->threads : &one;
+    int ntl = o->threads ? o->n_threads : 1;
+
+    if (o->verbose) printf("tune: %016llx nRows = %d nnz = %d\n", out->fingerprint, a->n_rows, a->nnz);
+    for (int q = 0; q < spmv_variant_count(); q++) {
+        const spmv_variant_t *v = spmv_variant_at(q);
+        if (!is_candidate(o, v)) continue;
+
+        for (int ti = 0; ti < (v->parallel ? ntl : 1); ti++) {
+            int t = v->parallel ? tl[ti] : 1;
+            if (!fits(o, v, a, t)) {
+                if (o->verbose) printf("  %-10s %3d over budget (%lld bytes)\n", v->name, t, v->mem(a, t));
+                continue;
+            }
+            set_num_threads(t);
+            void *h = v->build(a, t);
+            if (!h) {
+                if (o->verbose) printf("  %-10s %3d build failed\n", v->name, t);
+                continue;
+            }
+            if (!fits_built(o, v, h, a, t)) {
+                if (o->verbose) printf("  %-10s %3d over budget after build (%lld bytes)\n", v->name, t,
+                                       built_mem(v, h, a, t));
+                v->release(h);
+                continue;
+            }
+
+            v->run(h, x, y);
+            if (!same_vec_double_tol(y_ref, y, a->n_rows, v->tol)) {
+                if (o->verbose) printf("  %-10s %3d bruh: mismatch, dropped\n", v->name, t);
+                v->release(h);
+                continue;
+            }
+            //one warm call as a first timing, 3x slower than the best so far is not worth a full trial
+            long long t0 = now_ns();
+            v->run(h, x, y);
+            double first = (double)(now_ns() - t0);
+            if (out->h && first > 3.0 * out->ns) {
+                if (o->verbose) printf("  %-10s %3d %12.0f ns warm call, pruned\n", v->name, t, first);
+                v->release(h);
+                continue;
+            }
+
+            double ns = trial(v, h, x, y, first, trial_ns);
+            if (o->verbose) printf("  %-10s %3d %12.0f ns\n", v->name, t, ns);
+            if (!out->h || ns < out->ns) {
+                if (out->h) out->v->release(out->h);
+                out->v = v;
+                out->h = h;
+                out->threads = t;
+                out->ns = ns;
+            } else {
+                v->release(h);
+            }
+        }
+    }
+    set_num_threads(max_threads);
+    free(x); free(y_ref); free(y);
+
+    if (!out->h) return 0;
+    if (o->verbose) printf("tune: picked %s threads = %d (%.0f ns)\n", out->v->name, out->threads, out->ns);
+    if (o->cache_path && !cache_store(o->cache_path, out->fingerprint, options_key(o), max_threads, out->v->name,
+                                      out->threads, out->ns))
+        printf("tune: couldn't write cache %s\n", o->cache_path);
+    return 1;
+}
+
+void free_spmv_tuned(spmv_tuned_t *t) {
+    if (t->v && t->h) t->v->release(t->h);
+    t->v = NULL;
+    t->h = NULL;
+}
@@ -1,16 +1,109 @@
 #define _POSIX_C_SOURCE 200809L
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <omp.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
 
 #include "util.h"
 
+static int g_num_threads = 0;
+
 long long now_ns(void) {
     struct timespec ts;
     clock_gettime(CLOCK_MONOTONIC, &ts);
     return (long long)ts.tv_sec * 1000000000LL + (long long)ts.tv_nsec;
 }
 
+int get_num_threads(void) {
+    if (g_num_threads <= 0)
+		g_num_threads = omp_get_max_threads();
+    return g_num_threads;
+}
+
+void set_num_threads(int n) {
+    g_num_threads = (n > 0) ? n : omp_get_max_threads();
+}
+
+static long long proc_status_kb(const char *key) {
+    FILE *f = fopen("/proc/self/status", "r");
+    if (!f) return -1;
+
+    char line[256];
+    size_t klen = strlen(key);
+    long long kb = -1;
+    while (fgets(line, sizeof(line), f)) {
+        if (strncmp(line, key, klen) == 0 && line[klen] == ':') {
+            kb = atoll(line + klen + 1);
+            break;
+        }
+    }
+    fclose(f);
+    return kb;
+}
+
+long long peak_rss_kb(void) {
+    return proc_status_kb("VmHWM");
+}
+
+long long cur_rss_kb(void) {
+    return proc_status_kb("VmRSS");
+}
+
+int reset_peak_rss(void) {
+    FILE *f = fopen("/proc/self/clear_refs", "w");
+    if (!f) return 0;
+    int ok = fputs("5", f) >= 0;
+    if (fclose(f) != 0) ok = 0;
+    return ok;
+}
+
+long long forked_peak_rss_kb(int (*fn)(void *), void *arg) {
+    int fd[2];
+    if (pipe(fd) != 0) return -1;
+    fflush(stdout);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fd[0]);
+        close(fd[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        close(fd[0]);
+#ifdef __GLIBC__
+        //large blocks get fresh pages and the free chunks the parent left behind are given back,
+        //so reusing them shows up as growth too
+        mallopt(M_MMAP_THRESHOLD, 64 * 1024);
+        malloc_trim(0);
+#endif
+        //the parent's omp thread pool doesn't exist in the child, a team of more than one would hang
+        omp_set_num_threads(1);
+        set_num_threads(1);
+        reset_peak_rss();
+        long long base = cur_rss_kb();
+        long long kb = fn(arg) ? peak_rss_kb() - base : -1;
+        if (base < 0) kb = -1;
+        ssize_t w = write(fd[1], &kb, sizeof(kb));
+        close(fd[1]);
+        _exit(w == (ssize_t)sizeof(kb) ? 0 : 1);
+    }
+
+    close(fd[1]);
+    long long kb = -1;
+    if (read(fd[0], &kb, sizeof(kb)) != (ssize_t)sizeof(kb)) kb = -1;
+    close(fd[0]);
+    int status = 0;
+    if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) kb = -1;
+    return kb;
+}
+
 void print_int_array(const char *name, const int *a, int n) {
     printf("%s = [", name);
     for (int i = 0; i < n; i++) {
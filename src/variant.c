@@ -0,0 +1,502 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "variant.h"
+#include "formats.h"
+#include "spmv.h"
+#include "bench.h"
+#include "util.h"
+
+#define I4 ((long long)sizeof(int))
+#define D8 ((long long)sizeof(double))
+
+static void release_none(void *h) {
+    (void)h;
+}
+
+//y buffers of a scatter plan, private or owner as scatter_pick_mode would choose
+static long long scatter_plan_mem(int nthreads, int n_rows, int nnz) {
+    long long priv = (long long)nthreads * n_rows;
+    return (priv <= nnz ? priv * D8 : (long long)nnz * 2 * I4) + (long long)(nthreads + 1) * 3 * I4;
+}
+
+/* ---- crs, borrowed ---- */
+
+static void *build_crs(const crs_d_t *a, int nthreads) {
+    (void)nthreads;
+    return (void *)a;
+}
+
+static void traffic_crs(void *h, spmv_traffic_t *t) {
+    crs_d_traffic((const crs_d_t *)h, t);
+}
+
+static long long mem_crs(const crs_d_t *a, int nthreads) {
+    (void)a;
+    (void)nthreads;
+    return 0;
+}
+
+static void run_crs(void *h, const double *x, double *y) {
+    crs_spmv_double((const crs_d_t *)h, x, y);
+}
+
+static void run_crs_simd(void *h, const double *x, double *y) {
+    crs_spmv_double_simd((const crs_d_t *)h, x, y);
+}
+
+/* ---- crs with a row partition / merge plan ---- */
+
+typedef struct { const crs_d_t *a; crs_part_t part; } crs_par_h;
+
+static void *build_crs_par(const crs_d_t *a, int nthreads) {
+    crs_par_h *h = (crs_par_h *)malloc(sizeof(*h));
+    if (!h) return NULL;
+    h->a = a;
+    if (!crs_partition_nnz(a, nthreads, &h->part)) { free(h); return NULL; }
+    return h;
+}
+
+static void run_crs_par(void *h, const double *x, double *y) {
+    crs_par_h *p = (crs_par_h *)h;
+    crs_spmv_double_par(p->a, &p->part, x, y);
+}
+
+static void release_crs_par(void *h) {
+    free_crs_part(&((crs_par_h *)h)->part);
+    free(h);
+}
+
+static void traffic_crs_par(void *h, spmv_traffic_t *t) {
+    crs_d_traffic(((crs_par_h *)h)->a, t);
+}
+
+static long long mem_crs_par(const crs_d_t *a, int nthreads) {
+    (void)a;
+    return (long long)(nthreads + 1) * I4;
+}
+
+typedef struct { const crs_d_t *a; crs_merge_t m; } crs_merge_h;
+
+static void *build_crs_merge(const crs_d_t *a, int nthreads) {
+    crs_merge_h *h = (crs_merge_h *)malloc(sizeof(*h));
+    if (!h) return NULL;
+    h->a = a;
+    if (!crs_merge_plan(a, nthreads, &h->m)) { free(h); return NULL; }
+    return h;
+}
+
+static void run_crs_merge(void *h, const double *x, double *y) {
+    crs_merge_h *p = (crs_merge_h *)h;
+    crs_spmv_double_merge(p->a, &p->m, x, y);
+}
+
+static void release_crs_merge(void *h) {
+    free_crs_merge(&((crs_merge_h *)h)->m);
+    free(h);
+}
+
+static void traffic_crs_merge(void *h, spmv_traffic_t *t) {
+    crs_d_traffic(((crs_merge_h *)h)->a, t);
+}
+
+static long long mem_crs_merge(const crs_d_t *a, int nthreads) {
+    (void)a;
+    return (long long)(nthreads + 1) * (3 * I4 + D8);
+}
+
+/* ---- crs variants with their own copy ---- */
+
+static void *build_crs_delta(const crs_d_t *a, int nthreads) {
+    (void)nthreads;
+    crs_delta_d_t *h = (crs_delta_d_t *)malloc(sizeof(*h));
+    if (!h) return NULL;
+    if (!build_crs_delta_from_crs_double(a, h)) { free(h); return NULL; }
+    return h;
+}
+
+static void run_crs_delta(void *h, const double *x, double *y) {
+    crs_delta_spmv_double((const crs_delta_d_t *)h, x, y);
+}
+
+static void release_crs_delta(void *h) {
+    free_crs_delta_d((crs_delta_d_t *)h);
+    free(h);
+}
+
+static void traffic_crs_delta(void *h, spmv_traffic_t *t) {
+    crs_delta_traffic((const crs_delta_d_t *)h, t);
+}
+
+//escapes unknown until built, counted as none
+static long long mem_crs_delta(const crs_d_t *a, int nthreads) {
+    (void)nthreads;
+    long long n_seg = ((long long)a->nnz + CRS_DELTA_SEG - 1) / CRS_DELTA_SEG;
+    return (long long)a->nnz * (D8 + (long long)sizeof(uint16_t)) + (n_seg + a->n_rows + 1) * I4;
+}
+
+static void *build_crs_f(const crs_d_t *a, int nthreads) {
+    (void)nthreads;
+    crs_f_t *h = (crs_f_t *)malloc(sizeof(*h));
+    if (!h) return NULL;
+    if (!crs_d_to_f(a, h)) { free(h); return NULL; }
+    return h;
+}
+
+static void run_crs_f(void *h, const double *x, double *y) {
+    crs_f_spmv_double((const crs_f_t *)h, x, y);
+}
+
+static void release_crs_f(void *h) {
+    free_crs_f((crs_f_t *)h);
+    free(h);
+}
+
+static void traffic_crs_f(void *h, spmv_traffic_t *t) {
+    crs_f_traffic((const crs_f_t *)h, t);
+}
+
+static long long mem_crs_f(const crs_d_t *a, int nthreads) {
+    (void)nthreads;
+    return (long long)a->nnz * ((long long)sizeof(float) + I4) + (long long)(a->n_rows + 1) * I4;
+}
+
+/* ---- ccs / tjds (both go through a ccs copy) ---- */
+
+typedef struct { ccs_d_t ccs; scatter_plan_t plan; int have_plan; } ccs_h;
+
+static void *build_ccs_common(const crs_d_t *a, int nthreads, int with_plan) {
+    ccs_h *h = (ccs_h *)malloc(sizeof(*h));
+    if (!h) return NULL;
+    h->have_plan = 0;
+    if (!build_ccs_from_crs_double(a, &h->ccs)) { free(h); return NULL; }
+    if (with_plan) {
+        if (!ccs_par_plan(&h->ccs, nthreads, SCATTER_AUTO, &h->plan)) {
+            free_ccs_d(&h->ccs);
+            free(h);
+            return NULL;
+        }
+        h->have_plan = 1;
+    }
+    return h;
+}
+
+static void *build_ccs(const crs_d_t *a, int nthreads) {
+    return build_ccs_common(a, nthreads, 0);
+}
+
+static void *build_ccs_par(const crs_d_t *a, int nthreads) {
+    return build_ccs_common(a, nthreads, 1);
+}
+
+static void run_ccs(void *h, const double *x, double *y) {
+    ccs_spmv_double(&((ccs_h *)h)->ccs, x, y);
+}
+
+static void run_ccs_par(void *h, const double *x, double *y) {
+    ccs_h *p = (ccs_h *)h;
+    ccs_spmv_double_par(&p->ccs, &p->plan, x, y);
+}
+
+static void release_ccs(void *h) {
+    ccs_h *p = (ccs_h *)h;
+    if (p->have_plan) free_scatter_plan(&p->plan);
+    free_ccs_d(&p->ccs);
+    free(p);
+}
+
+static void traffic_ccs(void *h, spmv_traffic_t *t) {
+    ccs_d_traffic(&((ccs_h *)h)->ccs, t);
+}
+
+static long long mem_ccs(const crs_d_t *a, int nthreads) {
+    (void)nthreads;
+    return (long long)a->nnz * (D8 + I4) + (long long)(a->n_cols + 1) * I4;
+}
+
+static long long mem_ccs_par(const crs_d_t *a, int nthreads) {
+    return mem_ccs(a, nthreads) + scatter_plan_mem(nthreads, a->n_rows, a->nnz);
+}
+
+typedef struct { tjds_d_t t; scatter_plan_t plan; int have_plan; } tjds_h;
+
+static void *build_tjds_common(const crs_d_t *a, int nthreads, int with_plan) {
+    ccs_d_t ccs;
+    if (!build_ccs_from_crs_double(a, &ccs)) return NULL;
+
+    tjds_h *h = (tjds_h *)malloc(sizeof(*h));
+    if (!h) { free_ccs_d(&ccs); return NULL; }
+    h->have_plan = 0;
+    h->t = build_tjds_from_ccs_double(&ccs);
+    free_ccs_d(&ccs);
+    if (!h->t.tjd && a->nnz > 0) { free_tjds_d(&h->t); free(h); return NULL; }
+
+    if (with_plan) {
+        if (!tjds_par_plan(&h->t, nthreads, SCATTER_AUTO, &h->plan)) {
+            free_tjds_d(&h->t);
+            free(h);
+            return NULL;
+        }
+        h->have_plan = 1;
+    }
+    return h;
+}
+
+static void *build_tjds(const crs_d_t *a, int nthreads) {
+    return build_tjds_common(a, nthreads, 0);
+}
+
+static void *build_tjds_par(const crs_d_t *a, int nthreads) {
+    return build_tjds_common(a, nthreads, 1);
+}
+
+static void run_tjds(void *h, const double *x, double *y) {
+    tjds_spmv_double(&((tjds_h *)h)->t, x, y);
+}
+
+static void run_tjds_simd(void *h, const double *x, double *y) {
+    tjds_spmv_double_simd(&((tjds_h *)h)->t, x, y);
+}
+
+static void run_tjds_par(void *h, const double *x, double *y) {
+    tjds_h *p = (tjds_h *)h;
+    tjds_spmv_double_par(&p->t, &p->plan, x, y);
+}
+
+static void release_tjds(void *h) {
+    tjds_h *p = (tjds_h *)h;
+    if (p->have_plan) free_scatter_plan(&p->plan);
+    free_tjds_d(&p->t);
+    free(p);
+}
+
+static void traffic_tjds(void *h, spmv_traffic_t *t) {
+    tjds_d_traffic(&((tjds_h *)h)->t, t);
+}
+
+//the ccs it is built from is freed again, so only the tjds arrays stay
+static long long mem_tjds(const crs_d_t *a, int nthreads) {
+    (void)nthreads;
+    return (long long)a->nnz * (D8 + I4) + (long long)a->n_cols * 2 * I4;
+}
+
+static long long mem_tjds_par(const crs_d_t *a, int nthreads) {
+    return mem_tjds(a, nthreads) + scatter_plan_mem(nthreads, a->n_rows, a->nnz);
+}
+
+/* ---- jds ---- */
+
+typedef struct { jds_d_t j; crs_part_t part; double *work; } jds_h;
+
+static void *build_jds(const crs_d_t *a, int nthreads) {
+    jds_h *h = (jds_h *)malloc(sizeof(*h));
+    if (!h) return NULL;
+    if (!build_jds_from_crs_double(a, &h->j)) { free(h); return NULL; }
+    h->work = (double *)malloc((size_t)a->n_rows * sizeof(double) + 1);
+    if (!h->work || !jds_partition_nnz(&h->j, nthreads, &h->part)) {
+        free(h->work);
+        free_jds_d(&h->j);
+        free(h);
+        return NULL;
+    }
+    return h;
+}
+
+static void run_jds(void *h, const double *x, double *y) {
+    jds_h *p = (jds_h *)h;
+    jds_spmv_double(&p->j, x, y, p->work);
+}
+
+static void run_jds_par(void *h, const double *x, double *y) {
+    jds_h *p = (jds_h *)h;
+    jds_spmv_double_par(&p->j, &p->part, x, y, p->work);
+}
+
+static void release_jds(void *h) {
+    jds_h *p = (jds_h *)h;
+    free_crs_part(&p->part);
+    free_jds_d(&p->j);
+    free(p->work);
+    free(p);
+}
+
+static void traffic_jds(void *h, spmv_traffic_t *t) {
+    jds_d_traffic(&((jds_h *)h)->j, t);
+}
+
+static long long mem_jds(const crs_d_t *a, int nthreads) {
+    return (long long)a->nnz * (D8 + I4) + (long long)a->n_rows * (2 * I4 + D8) + (long long)(nthreads + 1) * I4;
+}
+
+/* ---- padded formats ---- */
+
+static void *build_sell(const crs_d_t *a, int nthreads) {
+    (void)nthreads;
+    sell_d_t *h = (sell_d_t *)malloc(sizeof(*h));
+    if (!h) return NULL;
+    int C = sell_simd_C();
+    if (!build_sell_from_crs_double(a, C, 32 * C, h)) { free(h); return NULL; }
+    return h;
+}
+
+static void run_sell(void *h, const double *x, double *y) {
+    sell_spmv_double_simd((const sell_d_t *)h, x, y);
+}
+
+static void release_sell(void *h) {
+    free_sell_d((sell_d_t *)h);
+    free(h);
+}
+
+static void traffic_sell(void *h, spmv_traffic_t *t) {
+    sell_d_traffic((const sell_d_t *)h, t);
+}
+
+//same sort as the build, so the padding is exact: slots plus chunk_ptr, chunk_len and perm
+static long long mem_sell(const crs_d_t *a, int nthreads) {
+    (void)nthreads;
+    int C = sell_simd_C();
+    long long slots = sell_count_slots(a, C, 32 * C);
+    long long n_chunks = (a->n_rows + C - 1) / C;
+    if (slots < 0) slots = a->nnz;
+    return slots * (D8 + I4) + (n_chunks * 2 + 1) * I4 + n_chunks * C * I4;
+}
+
+static void *build_ell(const crs_d_t *a, int nthreads) {
+    (void)nthreads;
+    ell_d_t *h = (ell_d_t *)malloc(sizeof(*h));
+    if (!h) return NULL;
+    if (!build_ell_from_crs_double(a, h)) { free(h); return NULL; }
+    return h;
+}
+
+static void run_ell(void *h, const double *x, double *y) {
+    ell_spmv_double((const ell_d_t *)h, x, y);
+}
+
+static void release_ell(void *h) {
+    free_ell_d((ell_d_t *)h);
+    free(h);
+}
+
+static void traffic_ell(void *h, spmv_traffic_t *t) {
+    ell_d_traffic((const ell_d_t *)h, t);
+}
+
+static long long mem_ell(const crs_d_t *a, int nthreads) {
+    (void)nthreads;
+    return (long long)a->n_rows * crs_max_row_len(a) * (D8 + I4);
+}
+
+static void *build_hyb(const crs_d_t *a, int nthreads) {
+    (void)nthreads;
+    hyb_d_t *h = (hyb_d_t *)malloc(sizeof(*h));
+    if (!h) return NULL;
+    if (!build_hyb_from_crs_double(a, -1, h)) { free(h); return NULL; }
+    return h;
+}
+
+static void run_hyb(void *h, const double *x, double *y) {
+    hyb_spmv_double((const hyb_d_t *)h, x, y);
+}
+
+static void release_hyb(void *h) {
+    free_hyb_d((hyb_d_t *)h);
+    free(h);
+}
+
+static void traffic_hyb(void *h, spmv_traffic_t *t) {
+    hyb_d_traffic((const hyb_d_t *)h, t);
+}
+
+static long long mem_hyb(const crs_d_t *a, int nthreads) {
+    (void)nthreads;
+    int K = hyb_choose_width(a);
+    long long coo = 0;
+    for (int i = 0; i < a->n_rows; i++) {
+        int len = a->row_ptr[i + 1] - a->row_ptr[i];
+        if (len > K) coo += len - K;
+    }
+    return (long long)a->n_rows * K * (D8 + I4) + coo * (D8 + 2 * I4);
+}
+
+//block shape from the dense profile (measured once per process), shared by build_bcsr and
+//mem_bcsr so the estimate sizes the same blocks
+static void bcsr_shape(const crs_d_t *a, int *r, int *c) {
+    static double prof[4][4];
+    static int have_prof = 0;
+    if (!have_prof) {
+        bench_bcsr_profile(256, prof);
+        have_prof = 1;
+    }
+    bcsr_choose_block(a, 8, prof, r, c, NULL);
+}
+
+static void *build_bcsr(const crs_d_t *a, int nthreads) {
+    (void)nthreads;
+    int r, c;
+    bcsr_shape(a, &r, &c);
+    bcsr_d_t *h = (bcsr_d_t *)malloc(sizeof(*h));
+    if (!h) return NULL;
+    if (!build_bcsr_from_crs_double(a, r, c, h)) { free(h); return NULL; }
+    return h;
+}
+
+static void run_bcsr(void *h, const double *x, double *y) {
+    bcsr_spmv_double((const bcsr_d_t *)h, x, y);
+}
+
+static void release_bcsr(void *h) {
+    free_bcsr_d((bcsr_d_t *)h);
+    free(h);
+}
+
+static void traffic_bcsr(void *h, spmv_traffic_t *t) {
+    bcsr_d_traffic((const bcsr_d_t *)h, t);
+}
+
+//exact fill (step 1) of the shape build_bcsr picks, turned back into a block count
+static long long mem_bcsr(const crs_d_t *a, int nthreads) {
+    (void)nthreads;
+    int r, c;
+    bcsr_shape(a, &r, &c);
+    long long n_brows = (a->n_rows + r - 1) / r;
+    long long nnzb = (long long)(bcsr_estimate_fill(a, r, c, 1) * a->nnz / (r * c) + 0.5);
+    return nnzb * r * c * D8 + nnzb * I4 + (n_brows + 1) * I4;
+}
+
+static const spmv_variant_t variants[] = {
+    { "crs",       0, 1, build_crs,        run_crs,        release_none,       traffic_crs,        mem_crs,        1e-8 },
+    { "crs_simd",  0, 1, build_crs,        run_crs_simd,   release_none,       traffic_crs,        mem_crs,        1e-8 },
+    { "crs_par",   1, 1, build_crs_par,    run_crs_par,    release_crs_par,    traffic_crs_par,    mem_crs_par,    1e-8 },
+    { "crs_merge", 1, 1, build_crs_merge,  run_crs_merge,  release_crs_merge,  traffic_crs_merge,  mem_crs_merge,  1e-8 },
+    { "crs_delta", 0, 0, build_crs_delta,  run_crs_delta,  release_crs_delta,  traffic_crs_delta,  mem_crs_delta,  1e-8 },
+    { "crs_f",     0, 0, build_crs_f,      run_crs_f,      release_crs_f,      traffic_crs_f,      mem_crs_f,      1e-5 },
+    { "ccs",       0, 0, build_ccs,        run_ccs,        release_ccs,        traffic_ccs,        mem_ccs,        1e-8 },
+    { "ccs_par",   1, 0, build_ccs_par,    run_ccs_par,    release_ccs,        traffic_ccs,        mem_ccs_par,    1e-8 },
+    { "tjds",      0, 0, build_tjds,       run_tjds,       release_tjds,       traffic_tjds,       mem_tjds,       1e-8 },
+    { "tjds_simd", 0, 0, build_tjds,       run_tjds_simd,  release_tjds,       traffic_tjds,       mem_tjds,       1e-8 },
+    { "tjds_par",  1, 0, build_tjds_par,   run_tjds_par,   release_tjds,       traffic_tjds,       mem_tjds_par,   1e-8 },
+    { "jds",       0, 0, build_jds,        run_jds,        release_jds,        traffic_jds,        mem_jds,        1e-8 },
+    { "jds_par",   1, 0, build_jds,        run_jds_par,    release_jds,        traffic_jds,        mem_jds,        1e-8 },
+    { "sell",      0, 0, build_sell,       run_sell,       release_sell,       traffic_sell,       mem_sell,       1e-8 },
+    { "ell",       0, 0, build_ell,        run_ell,        release_ell,        traffic_ell,        mem_ell,        1e-8 },
+    { "hyb",       0, 0, build_hyb,        run_hyb,        release_hyb,        traffic_hyb,        mem_hyb,        1e-8 },
+    { "bcsr",      0, 0, build_bcsr,       run_bcsr,       release_bcsr,       traffic_bcsr,       mem_bcsr,       1e-8 },
+};
+
+int spmv_variant_count(void) {
+    return (int)(sizeof(variants) / sizeof(variants[0]));
+}
+
+const spmv_variant_t *spmv_variant_at(int i) {
+    if (i < 0 || i >= spmv_variant_count()) return NULL;
+    return &variants[i];
+}
+
+const spmv_variant_t *spmv_variant_find(const char *name) {
+    for (int i = 0; i < spmv_variant_count(); i++)
+        if (strcmp(variants[i].name, name) == 0) return &variants[i];
+    return NULL;
+}